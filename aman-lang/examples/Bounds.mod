@@ -0,0 +1,30 @@
+MODULE Bounds;
+
+(* Indexing guarded by conditions on the index. check_codegen.sh compiles
+   it with -fbounds-check and checks that the guards remove the checks. *)
+
+TYPE
+  Table = ARRAY [16] OF INTEGER;
+
+VAR
+  Values: Table;
+
+(* The comparisons are cheap, so the AND is a select, not a branch. *)
+PROCEDURE Get* (i: INTEGER): INTEGER;
+BEGIN
+  IF (i >= 0) AND (i < 16) THEN
+    RETURN Values[i]
+  END;
+  RETURN 0
+END Get;
+
+(* Past the early return, both operands of the OR are known to be false. *)
+PROCEDURE Put* (i, v: INTEGER);
+BEGIN
+  IF (i < 0) OR (i >= 16) THEN
+    RETURN
+  END;
+  Values[i] := v
+END Put;
+
+END Bounds.
@@ -0,0 +1,56 @@
+MODULE Dispatch;
+
+(* The dispatch loop of a bytecode interpreter, which is what CASE is for.
+   An instruction is three words: the opcode and two operands. The program
+   runs n rounds over five instructions, so nearly all of the time goes to
+   fetching and dispatching. See bench_dispatch.c for the timing harness. *)
+
+CONST
+  Halt = 0;
+  LoadI = 1;   (* r[a] := b *)
+  Add = 2;     (* r[a] := r[a] + r[b] *)
+  SubI = 3;    (* r[a] := r[a] - b *)
+  MulMod = 4;  (* r[a] := r[a] * r[b] MOD Modulus *)
+  Jnz = 5;     (* IF r[a] # 0 THEN pc := b *)
+  Jmp = 6;     (* pc := b *)
+  Modulus = 1000003;
+
+  Code = ARRAY OF INTEGER {
+    LoadI, 0, 0,
+    LoadI, 2, 1,
+    Add, 0, 1,
+    MulMod, 2, 1,
+    Add, 0, 2,
+    SubI, 1, 1,
+    Jnz, 1, 6,
+    Halt, 0, 0 };
+
+TYPE Registers = ARRAY [4] OF INTEGER;
+
+(* Runs Code with n in r[1] and returns r[0]. *)
+PROCEDURE Run* (n: INTEGER): INTEGER;
+VAR
+  r: Registers;
+  pc, op, a, b: INTEGER;
+BEGIN
+  r[1] := n;
+  pc := 0;
+  WHILE pc >= 0 DO
+    op := Code[pc];
+    a := Code[pc + 1];
+    b := Code[pc + 2];
+    pc := pc + 3;
+    CASE op OF
+      Halt: pc := -1
+    | LoadI: r[a] := b
+    | Add: r[a] := r[a] + r[b]
+    | SubI: r[a] := r[a] - b
+    | MulMod: r[a] := r[a] * r[b] MOD Modulus
+    | Jnz: IF r[a] # 0 THEN pc := b END
+    | Jmp: pc := b
+    END
+  END;
+  RETURN r[0]
+END Run;
+
+END Dispatch.
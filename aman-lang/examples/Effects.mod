@@ -0,0 +1,22 @@
+MODULE Effects;
+
+(* Procedures whose function attributes check_codegen.sh inspects. *)
+
+EXCEPTION Failed;
+
+(* Its only effect is RAISE, which calls into the C++ runtime, so it must
+   not be memory(none). *)
+PROCEDURE Fail;
+BEGIN
+  RAISE Failed
+END Fail;
+
+PROCEDURE Check* (v: INTEGER): INTEGER;
+BEGIN
+  IF v < 0 THEN
+    Fail ()
+  END;
+  RETURN v
+END Check;
+
+END Effects.
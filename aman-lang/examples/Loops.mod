@@ -0,0 +1,44 @@
+MODULE Loops;
+
+(* Array loops whose memory accesses only TBAA tags and alias scopes tell
+   apart. loop_remarks.sh compiles it and prints what LICM and the loop
+   vectorizer did with them. *)
+
+TYPE
+  Ints = ARRAY [1024] OF INTEGER;
+  Reals = ARRAY [1024] OF REAL;
+
+VAR
+  Data: Ints;
+  Factor: INTEGER;
+
+(* dst is a VAR parameter and Data and Factor are module variables that are
+   never passed by reference, so their scopes are disjoint. Factor is loaded
+   once before the loop and the loop is vectorized without runtime checks. *)
+PROCEDURE Scale* (VAR dst: Ints);
+VAR i: INTEGER;
+BEGIN
+  FOR i := 0 TO 1023 DO
+    dst[i] := Data[i] * Factor
+  END
+END Scale;
+
+(* steps and v may refer to the same module variable, but an INTEGER and a
+   REAL never share memory. LICM keeps steps in a register in the loop. *)
+PROCEDURE Sum* (VAR v: Reals; VAR steps: INTEGER): REAL;
+VAR i: INTEGER; s: REAL;
+BEGIN
+  s := 0.0;
+  FOR i := 0 TO 1023 DO
+    s := s + v[i];
+    steps := steps + 1
+  END;
+  RETURN s
+END Sum;
+
+PROCEDURE SetFactor* (k: INTEGER);
+BEGIN
+  Factor := k
+END SetFactor;
+
+END Loops.
@@ -0,0 +1,54 @@
+MODULE Procedures;
+
+(* Several procedures that call each other, read and write module variables
+   and VAR parameters and select record fields, so that their IR carries
+   declarations, TBAA tags and alias scopes. check_irgen_threads.sh generates
+   it with different numbers of threads. *)
+
+TYPE
+  Point = RECORD x, y: INTEGER END;
+  Points = ARRAY [16] OF Point;
+
+VAR
+  Count: INTEGER;
+  Path: Points;
+
+PROCEDURE Swap (VAR a, b: INTEGER);
+VAR t: INTEGER;
+BEGIN
+  t := a;
+  a := b;
+  b := t
+END Swap;
+
+PROCEDURE Abs (v: INTEGER): INTEGER;
+BEGIN
+  IF v < 0 THEN
+    RETURN -v
+  END;
+  RETURN v
+END Abs;
+
+PROCEDURE Length (p: Point): INTEGER;
+BEGIN
+  RETURN Abs (p.x) + Abs (p.y)
+END Length;
+
+PROCEDURE Mirror (VAR p: Point);
+BEGIN
+  Swap (p.x, p.y);
+  Count := Count + 1
+END Mirror;
+
+PROCEDURE Total* (): INTEGER;
+VAR i, sum: INTEGER;
+BEGIN
+  sum := 0;
+  FOR i := 0 TO 15 DO
+    Mirror (Path[i]);
+    sum := sum + Length (Path[i])
+  END;
+  RETURN sum + Count
+END Total;
+
+END Procedures.
@@ -0,0 +1,76 @@
+#!/usr/bin/env bash
+# Times IR generation of a procedure with many locals in deeply nested
+# IF/WHILE statements, where SSA construction creates and removes most of
+# the phis. See examples/README.md.
+#
+# usage: bench_deep_cfg.sh [amanlang] [locals] [depth] [procedures]
+set -eu
+
+AMANLANG=${1:-amanlang}
+LOCALS=${2:-200}
+DEPTH=${3:-12}
+PROCS=${4:-20}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# Each level is a WHILE loop holding an IF that writes two of the locals,
+# then the next level. Every local is read at the end, so every loop header
+# and join needs a phi for it until the trivial ones are removed.
+gen_proc () {
+    echo "PROCEDURE Deep$1* (n: INTEGER): INTEGER;"
+    echo "VAR"
+    I=0
+    while [ $I -lt "$LOCALS" ]; do
+        echo "  v$I: INTEGER;"
+        I=$((I + 1))
+    done
+    echo "  k: INTEGER;"
+    echo "BEGIN"
+    I=0
+    while [ $I -lt "$LOCALS" ]; do
+        echo "  v$I := $I;"
+        I=$((I + 1))
+    done
+    echo "  k := n;"
+    L=0
+    while [ $L -lt "$DEPTH" ]; do
+        A=$((L * 2 % LOCALS))
+        B=$(((L * 2 + 1) % LOCALS))
+        echo "  WHILE k > $L DO"
+        echo "  IF k MOD 2 = 0 THEN v$A := v$A + k ELSE v$B := v$B - 1 END;"
+        L=$((L + 1))
+    done
+    L=0
+    while [ $L -lt "$DEPTH" ]; do
+        echo "  k := k - 1"
+        echo "  END;"
+        L=$((L + 1))
+    done
+    printf "  RETURN v0"
+    I=1
+    while [ $I -lt "$LOCALS" ]; do
+        printf " + v$I"
+        I=$((I + 1))
+    done
+    echo
+    echo "END Deep$1;"
+    echo
+}
+
+{
+    echo "MODULE DeepCFG;"
+    echo
+    P=0
+    while [ $P -lt "$PROCS" ]; do
+        gen_proc $P
+        P=$((P + 1))
+    done
+    echo "END DeepCFG."
+} >"$TMP/DeepCFG.mod"
+
+echo "$PROCS procedures, $LOCALS locals, depth $DEPTH"
+# -O0 leaves the phis of the front end in the output and keeps the
+# optimizer out of the timing.
+time "$AMANLANG" -O0 -emitir -o "$TMP/DeepCFG.ll" "$TMP/DeepCFG.mod"
+PHIS=$(grep -c " = phi " "$TMP/DeepCFG.ll" || true)
+echo "$PHIS phis left"
@@ -0,0 +1,56 @@
+/*
+ * Times Run of Records.mod, see examples/README.md.
+ *
+ * usage: bench_records [rounds]
+ */
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Records.Run, named as CGModule::mangleName names it. */
+extern int64_t _t7Records3Run_t (int64_t n);
+
+/* What Run computes, to check the result against. */
+static int64_t reference (int64_t n) {
+    int64_t S[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    int64_t X = 0, Y = 0;
+    for (int64_t I = n; I > 0; --I) {
+        int64_t A = S[0];
+        for (int J = 0; J < 7; ++J)
+            S[J] = S[J + 1];
+        S[7] = (A + I) % 1000003;
+        X += S[7];
+        Y += 1;
+    }
+    return X + Y + S[0];
+}
+
+static double now (void) {
+    struct timespec Ts;
+    clock_gettime (CLOCK_MONOTONIC, &Ts);
+    return Ts.tv_sec + Ts.tv_nsec * 1e-9;
+}
+
+int main (int argc, char** argv) {
+    int64_t Rounds = argc > 1 ? strtoll (argv[1], NULL, 10) : 10000000;
+    if (Rounds <= 0) {
+        fprintf (stderr, "usage: %s [rounds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double Start   = now ();
+    int64_t Result = _t7Records3Run_t (Rounds);
+    double Elapsed = now () - Start;
+
+    if (Result != reference (Rounds)) {
+        fprintf (stderr, "wrong result %" PRId64 ", expected %" PRId64 "\n", Result, reference (Rounds));
+        return EXIT_FAILURE;
+    }
+
+    /* Step, AddVec and MakeVec per round. */
+    printf ("%" PRId64 " rounds in %.3f s, %.2f ns per call\n", Rounds, Elapsed,
+    Elapsed * 1e9 / (3.0 * Rounds));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Checks properties of the IR the compiler generates for the examples.
+#
+# usage: check_codegen.sh [amanlang]
+set -eu
+
+AMANLANG=${1:-amanlang}
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+STATUS=0
+
+# Compiles an example to IR: compile NAME FLAGS...
+compile () {
+    NAME=$1
+    shift
+    "$AMANLANG" "$@" -emitir -o "$TMP/$NAME.ll" "$DIR/$NAME.mod" >/dev/null
+}
+
+# Prints the attribute group of a defined function: fn_attrs FILE SYMBOL
+fn_attrs () {
+    GROUP=$(sed -n "s/^define .*@$2(.*) \(.* \)\{0,1\}\(#[0-9]*\).*{\$/\2/p" "$1")
+    grep "^attributes $GROUP = " "$1"
+}
+
+# Prints the body of a defined function: fn_body FILE SYMBOL
+fn_body () {
+    sed -n "/^define .*@$2(/,/^}/p" "$1"
+}
+
+fail () {
+    echo "FAIL: $*" >&2
+    STATUS=1
+}
+
+# Succeeds if the attributes allow writes to inaccessible memory:
+# writes_inaccessible ATTRS
+writes_inaccessible () {
+    MEM=$(echo "$1" | grep -o 'memory([^)]*)' || true)
+    case "$MEM" in
+    "" | *"inaccessiblemem: readwrite"* | *"inaccessiblemem: write"*) return 0 ;;
+    *"inaccessiblemem:"*) return 1 ;;
+    "memory(readwrite"* | "memory(write"*) return 0 ;;
+    *) return 1 ;;
+    esac
+}
+
+# A procedure that only raises calls __cxa_allocate_exception and
+# __cxa_throw, which change the runtime's state.
+compile Effects -O0
+ATTRS=$(fn_attrs "$TMP/Effects.ll" _t7Effects4Fail_t)
+writes_inaccessible "$ATTRS" || fail "Effects.Fail must write inaccessible memory: $ATTRS"
+
+# An index guarded by an AND or an OR of range conditions needs no bounds
+# check, whether the operands are joined by branches or by a select.
+compile Bounds -O0 -fbounds-check
+for PROC in Get Put; do
+    if fn_body "$TMP/Bounds.ll" "_t6Bounds3${PROC}_t" | grep -q "__aman_check_failed"; then
+        fail "Bounds.$PROC must not check the bounds of its guarded index"
+    fi
+done
+
+[ $STATUS -eq 0 ] && echo "all checks passed"
+exit $STATUS
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Checks that -irgen-threads gives the same IR for any number of threads.
+#
+# usage: check_irgen_threads.sh [amanlang] [file.mod]
+#
+# A batch size of one procedure makes every procedure a partial module of its
+# own, so the linking and the merging of metadata are exercised the most.
+set -eu
+
+AMANLANG=${1:-amanlang}
+INPUT=${2:-$(dirname "$0")/Procedures.mod}
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+for N in 1 2 8; do
+    "$AMANLANG" -O0 -emitir -irgen-threads=$N -irgen-batch-size=1 -o "$TMP/ir.$N.ll" "$INPUT" >/dev/null
+done
+
+STATUS=0
+for N in 2 8; do
+    if ! diff -u "$TMP/ir.1.ll" "$TMP/ir.$N.ll"; then
+        echo "IR for -irgen-threads=$N differs from -irgen-threads=1" >&2
+        STATUS=1
+    fi
+done
+[ $STATUS -eq 0 ] && echo "IR is identical for -irgen-threads=1, 2 and 8"
+exit $STATUS
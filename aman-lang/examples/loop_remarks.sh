@@ -0,0 +1,18 @@
+#!/bin/sh
+# Compiles Loops.mod at -O3 and prints the remarks of LICM and the loop
+# vectorizer, including the loops they left alone. See examples/README.md.
+#
+# usage: loop_remarks.sh [amanlang] [flags...]
+set -eu
+
+AMANLANG=${1:-amanlang}
+[ $# -gt 0 ] && shift
+DIR=$(dirname "$0")
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# -g gives the remarks source locations.
+"$AMANLANG" -O3 -g -filetype=obj "$@" \
+    -pass-remarks='licm|loop-vectorize' \
+    -pass-remarks-missed='licm|loop-vectorize' \
+    -o "$TMP/Loops.o" "$DIR/Loops.mod" 2>&1
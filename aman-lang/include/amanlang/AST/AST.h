@@ -1,5 +1,6 @@
 #pragma once
 #include "amanlang/Lexer/Token.h"
+#include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/SourceMgr.h"
@@ -69,10 +70,12 @@ class Decl {
         DK_Var,
         DK_Param,
         DK_Proc,
+        DK_Exception,
 
         // Types
         DK_AliasType,
         DK_ArrayType,
+        DK_OpenArrayType,
         DK_PervasiveType,
         DK_PointerType,
         DK_RecordType,
@@ -167,6 +170,25 @@ class ConstantDecl : public Decl {
     Expr* E;
 };
 
+/**
+ * Represents an exception declaration in the Aman programming language.
+ *
+ * An exception carries no value; it is only identified by its declaration,
+ * which `RAISE` and the handlers of a `TRY` statement refer to.
+ *
+ * Example: `EXCEPTION NotFound, Overflow;`
+ */
+class ExceptionDecl : public Decl {
+    public:
+    ExceptionDecl (Decl* EnclosingDecl, llvm::SMLoc Loc, llvm::StringRef Name)
+    : Decl (DK_Exception, EnclosingDecl, Loc, Name) {
+    }
+
+    static bool classof (const Decl* D) {
+        return D->getKind () == DK_Exception;
+    }
+};
+
 #pragma mark - ## Type Declarations
 
 /**
@@ -251,6 +273,36 @@ class ArrayTypeDecl : public TypeDecl {
     }
 };
 
+/**
+ * Represents the type of an open array parameter in the Aman programming language.
+ *
+ * The `OpenArrayTypeDecl` class represents the anonymous type of a formal
+ * parameter declared as `ARRAY OF T`. It accepts arrays of any length with
+ * the element type `T`; the length is passed along and read with `HIGH`.
+ * Each parameter gets a type of its own.
+ *
+ * @param EnclosingDecL The procedure whose parameter has this type.
+ * @param Loc The source location of `ARRAY`.
+ * @param Type The element type.
+ * @example `PROCEDURE Sum (a: ARRAY OF INTEGER): INTEGER;`
+ */
+class OpenArrayTypeDecl : public TypeDecl {
+    TypeDecl* Type;
+
+    public:
+    OpenArrayTypeDecl (Decl* EnclosingDecl, llvm::SMLoc Loc, TypeDecl* Type)
+    : TypeDecl (DK_OpenArrayType, EnclosingDecl, Loc, "ARRAY OF"), Type (Type) {
+    }
+
+    TypeDecl* getType () const {
+        return Type;
+    }
+
+    static bool classof (const Decl* D) {
+        return D->getKind () == DK_OpenArrayType;
+    }
+};
+
 /**
  * Represents a pervasive type declaration in the Aman programming language.
  *
@@ -261,18 +313,68 @@ class ArrayTypeDecl : public TypeDecl {
  * @param EnclosingDecL The declaration that encloses this pervasive type declaration.
  * @param Loc The source location of this declaration.
  * @param Name The name of the new pervasive type.
+ * @param Kind Whether the type is BOOLEAN, a signed or an unsigned integer, or a real.
+ * @param BitWidth The number of bits of a value, 1 for BOOLEAN.
  */
 class PervasiveTypeDecl : public TypeDecl {
     public:
-    PervasiveTypeDecl (Decl* EnclosingDecL, llvm::SMLoc Loc, llvm::StringRef Name)
-    : TypeDecl (DK_PervasiveType, EnclosingDecL, Loc, Name) {
+    enum PervasiveKind { PK_Boolean, PK_Signed, PK_Unsigned, PK_Real };
+
+    PervasiveTypeDecl (Decl* EnclosingDecL, llvm::SMLoc Loc, llvm::StringRef Name, PervasiveKind Kind, unsigned BitWidth)
+    : TypeDecl (DK_PervasiveType, EnclosingDecL, Loc, Name), Kind (Kind), BitWidth (BitWidth) {
+    }
+
+    PervasiveKind getPervasiveKind () const {
+        return Kind;
+    }
+    unsigned getBitWidth () const {
+        return BitWidth;
+    }
+    bool isInteger () const {
+        return Kind == PK_Signed || Kind == PK_Unsigned;
+    }
+    bool isReal () const {
+        return Kind == PK_Real;
+    }
+    bool isSigned () const {
+        return Kind == PK_Signed;
     }
 
     static bool classof (const Decl* D) {
         return D->getKind () == DK_PervasiveType;
     }
+
+    private:
+    PervasiveKind Kind;
+    unsigned BitWidth;
 };
 
+/**
+ * Returns the integer type a type stands for, looking through aliases, or
+ * nullptr if it is not an integer type.
+ *
+ * @example `TYPE Count = INT8;` is an integer type of 8 bits.
+ */
+inline PervasiveTypeDecl* getIntegerType (TypeDecl* Ty) {
+    while (auto* Alias = llvm::dyn_cast_or_null<AliasTypeDecl> (Ty))
+        Ty = Alias->getType ();
+    auto* Pervasive = llvm::dyn_cast_or_null<PervasiveTypeDecl> (Ty);
+    return Pervasive && Pervasive->isInteger () ? Pervasive : nullptr;
+}
+
+/**
+ * Returns the real type a type stands for, looking through aliases, or
+ * nullptr if it is not a real type.
+ *
+ * @example `TYPE Scalar = LONGREAL;` is a real type of 64 bits.
+ */
+inline PervasiveTypeDecl* getRealType (TypeDecl* Ty) {
+    while (auto* Alias = llvm::dyn_cast_or_null<AliasTypeDecl> (Ty))
+        Ty = Alias->getType ();
+    auto* Pervasive = llvm::dyn_cast_or_null<PervasiveTypeDecl> (Ty);
+    return Pervasive && Pervasive->isReal () ? Pervasive : nullptr;
+}
+
 /**
  * Represents a pointer type declaration in the Aman programming language.
  *
@@ -372,12 +474,22 @@ class VariableDecl : public Decl {
         return Ty;
     }
 
+    // Passing a variable as VAR argument is the only way to give it a second
+    // name. Set by EffectAnalysis.
+    bool isAddressTaken () const {
+        return AddressTaken;
+    }
+    void setAddressTaken () {
+        AddressTaken = true;
+    }
+
     static bool classof (const Decl* D) {
         return D->getKind () == DK_Var;
     }
 
     private:
     TypeDecl* Ty;
+    bool AddressTaken = false;
 };
 
 
@@ -404,6 +516,21 @@ class FormalParameterDecl : public Decl {
     bool isVar () {
         return IsVar;
     }
+    // Open arrays are passed by address plus length. Unless declared VAR,
+    // they are read-only in the procedure, so the address can be the
+    // argument's own.
+    bool isOpenArray () {
+        return llvm::isa<OpenArrayTypeDecl> (Ty);
+    }
+
+    // A value parameter passed as VAR argument inside a TRY statement, which
+    // the callee may write before it raises. Set by EffectAnalysis.
+    bool isAddressTaken () const {
+        return AddressTaken;
+    }
+    void setAddressTaken () {
+        AddressTaken = true;
+    }
 
     static bool classof (const Decl* D) {
         return D->getKind () == DK_Param;
@@ -412,6 +539,31 @@ class FormalParameterDecl : public Decl {
     private:
     TypeDecl* Ty;
     bool IsVar;
+    bool AddressTaken = false;
+};
+
+/**
+ * Summarizes the side effects of a procedure, including everything it calls.
+ *
+ * The summary is filled in by `EffectAnalysis` after the whole module has been
+ * checked; until then it is conservative. Memory is split the way LLVM's
+ * `memory(...)` attribute splits it: `ArgMem` is what the procedure reaches
+ * through its VAR parameters, `Globals` is module variables and memory reached
+ * through pointers.
+ */
+class ProcedureEffects {
+    public:
+    enum ModRef : uint8_t { MR_None = 0, MR_Ref = 1, MR_Mod = 2, MR_ModRef = 3 };
+
+    ModRef ArgMem     = MR_ModRef;
+    ModRef Globals    = MR_ModRef;
+    bool MayUnwind    = true;
+    bool MayNotReturn = true; // Loops, or calls that may not return
+    bool MayFailCheck = true; // Divisions or indexing a runtime check may reject
+    bool MayTrap      = true; // A CASE without ELSE, checked whatever the options
+    bool MayAllocate  = true; // NEW or DISPOSE, which use the runtime's heap
+    bool MayRecurse   = true;
+    bool Computed     = false;
 };
 
 /**
@@ -465,6 +617,19 @@ class ProcedureDecl : public Decl {
     void setStmts (StmtList& L) {
         Stmts = L;
     }
+    const ProcedureEffects& getEffects () const {
+        return Effects;
+    }
+    void setEffects (const ProcedureEffects& E) {
+        Effects = E;
+    }
+    // Marked with `*`, so other modules may call it.
+    bool isExported () const {
+        return Exported;
+    }
+    void setExported () {
+        Exported = true;
+    }
 
     static bool classof (const Decl* D) {
         return D->getKind () == DK_Proc;
@@ -475,6 +640,8 @@ class ProcedureDecl : public Decl {
     TypeDecl* RetType;
     DeclList Decls;
     StmtList Stmts;
+    ProcedureEffects Effects;
+    bool Exported = false;
 };
 
 /// Represents information about an operator, including its location, kind, and whether it is unspecified.
@@ -533,11 +700,15 @@ class Expr {
         EK_Infix,
         EK_Prefix,
         EK_Int,
+        EK_Real,
         EK_Bool,
         EK_Var,
         EK_Const,
         EK_Func,
         EK_Designator,
+        EK_Conv,
+        EK_High,
+        EK_Aggregate,
     };
 
     private:
@@ -626,6 +797,9 @@ class IntegerLiteral : public Expr {
     IntegerLiteral (llvm::SMLoc Loc, const llvm::APSInt& Value, TypeDecl* Ty)
     : Expr (EK_Int, Ty, true), Loc (Loc), Value (Value) {
     }
+    llvm::SMLoc getLocation () const {
+        return Loc;
+    }
     llvm::APSInt& getValue () {
         return Value;
     }
@@ -639,6 +813,32 @@ class IntegerLiteral : public Expr {
     llvm::APSInt Value;
 };
 
+/**
+ * Represents a real literal expression in the abstract syntax tree (AST).
+ * The value has the semantics of its type, IEEE single for REAL and double
+ * for LONGREAL.
+ */
+class RealLiteral : public Expr {
+    public:
+    RealLiteral (llvm::SMLoc Loc, const llvm::APFloat& Value, TypeDecl* Ty)
+    : Expr (EK_Real, Ty, true), Loc (Loc), Value (Value) {
+    }
+    llvm::SMLoc getLocation () const {
+        return Loc;
+    }
+    const llvm::APFloat& getValue () {
+        return Value;
+    }
+
+    static bool classof (const Expr* E) {
+        return E->getKind () == EK_Real;
+    }
+
+    private:
+    llvm::SMLoc Loc;
+    llvm::APFloat Value;
+};
+
 /**
  * Represents a boolean literal expression in the abstract syntax tree (AST).
  * A boolean literal holds a boolean value and its location in the source code.
@@ -785,9 +985,13 @@ class DerefSelector : public Selector {
 
 class Designator : public Expr {
     public:
-    Designator (VariableDecl* Var) : Expr (EK_Var, Var->getType (), false) {};
+    Designator (VariableDecl* Var)
+    : Expr (EK_Designator, Var->getType (), false), Var (Var) {};
     Designator (FormalParameterDecl* Param)
-    : Expr (EK_Designator, Param->getType (), false) {};
+    : Expr (EK_Designator, Param->getType (), false), Var (Param) {};
+    // A structured constant, which is read like a variable.
+    Designator (ConstantDecl* Const)
+    : Expr (EK_Designator, Const->getExpr ()->getType (), false), Var (Const) {};
 
     void addSelector (Selector* Sel) {
         Lst.push_back (Sel);
@@ -863,6 +1067,82 @@ class FunctionCallExpr : public Expr {
     ExprList Params;
 };
 
+/**
+ * Represents the conversion of an integer expression to another integer type.
+ * Widening conversions are inserted by Sema, narrowing ones are written like
+ * a function call and wrap around.
+ *
+ * Example: `INT8 (x)` keeps the low 8 bits of `x`.
+ */
+class ConversionExpr : public Expr {
+    public:
+    ConversionExpr (Expr* E, TypeDecl* Ty) : Expr (EK_Conv, Ty, E->isConst ()), E (E) {
+    }
+
+    Expr* getExpr () {
+        return E;
+    }
+
+    static bool classof (const Expr* E) {
+        return E->getKind () == EK_Conv;
+    }
+
+    private:
+    Expr* E;
+};
+
+/**
+ * Represents `HIGH (a)` of an open array parameter, the index of its last
+ * element. For an array of fixed length, Sema folds it into a literal.
+ *
+ * Example: `FOR i := 0 TO HIGH (a) DO ... END`
+ */
+class HighExpr : public Expr {
+    public:
+    HighExpr (FormalParameterDecl* Param, TypeDecl* Ty) : Expr (EK_High, Ty, false), Param (Param) {
+    }
+
+    FormalParameterDecl* getParam () {
+        return Param;
+    }
+
+    static bool classof (const Expr* E) {
+        return E->getKind () == EK_High;
+    }
+
+    private:
+    FormalParameterDecl* Param;
+};
+
+/**
+ * Represents a structured constant, the value of an array or a record given
+ * element by element. A nested aggregate takes its type from the enclosing
+ * one; Sema sets the types and folds the scalar elements into literals.
+ *
+ * Example: `Point {1, 2}`, `ARRAY OF Point {{0, 0}, {1, 2}}`
+ */
+class AggregateLiteral : public Expr {
+    public:
+    AggregateLiteral (llvm::SMLoc Loc, ExprList& Elements)
+    : Expr (EK_Aggregate, nullptr, true), Loc (Loc), Elements (Elements) {
+    }
+
+    llvm::SMLoc getLocation () const {
+        return Loc;
+    }
+    ExprList& getElements () {
+        return Elements;
+    }
+
+    static bool classof (const Expr* E) {
+        return E->getKind () == EK_Aggregate;
+    }
+
+    private:
+    llvm::SMLoc Loc;
+    ExprList Elements;
+};
+
 /**
  * Represents a statement in the abstract syntax tree (AST).
  * Statements can be of various kinds, such as assignment, procedure call, if, while, and return.
@@ -870,19 +1150,35 @@ class FunctionCallExpr : public Expr {
  */
 class Stmt {
     public:
-    enum StmtKind { SK_Assign, SK_ProcCall, SK_If, SK_While, SK_Return };
+    enum StmtKind {
+        SK_Assign,
+        SK_ProcCall,
+        SK_If,
+        SK_Case,
+        SK_While,
+        SK_For,
+        SK_Return,
+        SK_New,
+        SK_Dispose,
+        SK_Raise,
+        SK_Try
+    };
 
     private:
     const StmtKind Kind;
+    llvm::SMLoc Loc;
 
     protected:
-    Stmt (StmtKind Kind) : Kind (Kind) {
+    Stmt (StmtKind Kind, llvm::SMLoc Loc) : Kind (Kind), Loc (Loc) {
     }
 
     public:
     StmtKind getKind () const {
         return Kind;
     }
+    llvm::SMLoc getLocation () const {
+        return Loc;
+    }
 };
 
 /**
@@ -891,8 +1187,8 @@ class Stmt {
  */
 class AssignmentStatement : public Stmt {
     public:
-    AssignmentStatement (Designator* Var, Expr* E)
-    : Stmt (SK_Assign), Var (Var), E (E) {
+    AssignmentStatement (llvm::SMLoc Loc, Designator* Var, Expr* E)
+    : Stmt (SK_Assign, Loc), Var (Var), E (E) {
     }
 
     Designator* getVar () {
@@ -923,8 +1219,8 @@ class AssignmentStatement : public Stmt {
  */
 class ProcedureCallStatement : public Stmt {
     public:
-    ProcedureCallStatement (ProcedureDecl* Proc, ExprList& Params)
-    : Stmt (SK_ProcCall), Proc (Proc), Params (Params) {
+    ProcedureCallStatement (llvm::SMLoc Loc, ProcedureDecl* Proc, ExprList& Params)
+    : Stmt (SK_ProcCall, Loc), Proc (Proc), Params (Params) {
     }
 
     ProcedureDecl* getProc () {
@@ -952,8 +1248,8 @@ class ProcedureCallStatement : public Stmt {
  */
 class IfStatement : public Stmt {
     public:
-    IfStatement (Expr* Cond, StmtList& IfStmts, StmtList& ElseStmts)
-    : Stmt (SK_If), Cond (Cond), IfStmts (IfStmts), ElseStmts (ElseStmts) {
+    IfStatement (llvm::SMLoc Loc, Expr* Cond, StmtList& IfStmts, StmtList& ElseStmts)
+    : Stmt (SK_If, Loc), Cond (Cond), IfStmts (IfStmts), ElseStmts (ElseStmts) {
     }
 
     Expr* getCond () {
@@ -984,8 +1280,8 @@ class IfStatement : public Stmt {
  */
 class WhileStatement : public Stmt {
     public:
-    WhileStatement (Expr* Cond, StmtList& Stmts)
-    : Stmt (SK_While), Cond (Cond), Stmts (Stmts) {
+    WhileStatement (llvm::SMLoc Loc, Expr* Cond, StmtList& Stmts)
+    : Stmt (SK_While, Loc), Cond (Cond), Stmts (Stmts) {
     }
 
     Expr* getCond () {
@@ -1004,6 +1300,118 @@ class WhileStatement : public Stmt {
     StmtList Stmts;
 };
 
+/**
+ * Represents a counted loop in the abstract syntax tree (AST).
+ * The control variable runs from Start to End in steps of Step, which is a
+ * constant other than 0. End is evaluated once, before the first iteration.
+ *
+ * Example: `FOR i := 0 TO n - 1 BY 2 DO ... END`
+ */
+class ForStatement : public Stmt {
+    public:
+    ForStatement (llvm::SMLoc Loc, VariableDecl* Var, Expr* Start, Expr* End, int64_t Step)
+    : Stmt (SK_For, Loc), Var (Var), Start (Start), End (End), Step (Step) {
+    }
+
+    VariableDecl* getVar () {
+        return Var;
+    }
+    Expr* getStart () {
+        return Start;
+    }
+    Expr* getEnd () {
+        return End;
+    }
+    int64_t getStep () const {
+        return Step;
+    }
+    const StmtList& getStmts () {
+        return Stmts;
+    }
+    void setStmts (StmtList& L) {
+        Stmts = L;
+    }
+
+    static bool classof (const Stmt* S) {
+        return S->getKind () == SK_For;
+    }
+
+    private:
+    VariableDecl* Var;
+    Expr* Start;
+    Expr* End;
+    int64_t Step;
+    StmtList Stmts;
+};
+
+/**
+ * A label of a CASE statement: a single value, or a range `Low .. High`.
+ * Sema folds the bounds to constants of the selector type.
+ */
+struct CaseLabel {
+    llvm::APSInt Low;
+    llvm::APSInt High;
+};
+
+using CaseLabelList = std::vector<CaseLabel>;
+
+/**
+ * An alternative of a CASE statement: the statements run if the selector
+ * matches one of its labels.
+ */
+struct CaseAlternative {
+    CaseLabelList Labels;
+    StmtList Stmts;
+};
+
+using CaseList = std::vector<CaseAlternative>;
+
+/**
+ * Represents a case statement in the abstract syntax tree (AST).
+ * The selector, an integer, is evaluated once; control continues in the
+ * alternative with a matching label. The labels of a CASE statement don't
+ * overlap. If none matches, the ELSE part runs, and without one a runtime
+ * check fails.
+ *
+ * Example: `CASE op OF 0: Push (x) | 1, 2: Pop | 10 .. 19: Jump (op - 10) ELSE Halt END`
+ */
+class CaseStatement : public Stmt {
+    public:
+    CaseStatement (llvm::SMLoc Loc, Expr* Selector)
+    : Stmt (SK_Case, Loc), Selector (Selector), HasElse (false) {
+    }
+
+    Expr* getSelector () {
+        return Selector;
+    }
+    const CaseList& getCases () {
+        return Cases;
+    }
+    void addCase (CaseLabelList& Labels, StmtList& Stmts) {
+        Cases.push_back ({ Labels, Stmts });
+    }
+    const StmtList& getElseStmts () {
+        return ElseStmts;
+    }
+    void setElseStmts (StmtList& L) {
+        ElseStmts = L;
+        HasElse   = true;
+    }
+    bool hasElse () const {
+        return HasElse;
+    }
+
+    static bool classof (const Stmt* S) {
+        return S->getKind () == SK_Case;
+    }
+
+    private:
+    Expr* Selector;
+    CaseList Cases;
+    StmtList ElseStmts;
+    bool HasElse; // An empty ELSE part still catches every other value
+};
+
 /**
  * Represents a return statement in the abstract syntax tree (AST).
  * A return statement holds an expression to be returned from a function.
@@ -1012,7 +1420,7 @@ class WhileStatement : public Stmt {
  */
 class ReturnStatement : public Stmt {
     public:
-    ReturnStatement (Expr* E) : Stmt (SK_Return), E (E) {
+    ReturnStatement (llvm::SMLoc Loc, Expr* E) : Stmt (SK_Return, Loc), E (E) {
     }
 
     Expr* getExpr () {
@@ -1027,4 +1435,123 @@ class ReturnStatement : public Stmt {
     Expr* E;
 };
 
+/**
+ * Represents a call of the pervasive procedure NEW in the abstract syntax tree (AST).
+ * The pointer variable is set to a new, uninitialized object of its base type.
+ *
+ * Example: `NEW (p)`
+ */
+class NewStatement : public Stmt {
+    public:
+    NewStatement (llvm::SMLoc Loc, Designator* Ptr) : Stmt (SK_New, Loc), Ptr (Ptr) {
+    }
+
+    Designator* getPtr () {
+        return Ptr;
+    }
+
+    static bool classof (const Stmt* S) {
+        return S->getKind () == SK_New;
+    }
+
+    private:
+    Designator* Ptr;
+};
+
+/**
+ * Represents a call of the pervasive procedure DISPOSE in the abstract syntax tree (AST).
+ * The object the pointer variable points to is freed, and the variable is set to NIL.
+ *
+ * Example: `DISPOSE (p)`
+ */
+class DisposeStatement : public Stmt {
+    public:
+    DisposeStatement (llvm::SMLoc Loc, Designator* Ptr) : Stmt (SK_Dispose, Loc), Ptr (Ptr) {
+    }
+
+    Designator* getPtr () {
+        return Ptr;
+    }
+
+    static bool classof (const Stmt* S) {
+        return S->getKind () == SK_Dispose;
+    }
+
+    private:
+    Designator* Ptr;
+};
+
+/**
+ * Represents a raise statement in the abstract syntax tree (AST).
+ * Control continues in the innermost handler of the exception, which may be
+ * in a procedure further up the call chain.
+ *
+ * Example: `RAISE NotFound`
+ */
+class RaiseStatement : public Stmt {
+    public:
+    RaiseStatement (llvm::SMLoc Loc, ExceptionDecl* Exc) : Stmt (SK_Raise, Loc), Exc (Exc) {
+    }
+
+    ExceptionDecl* getException () {
+        return Exc;
+    }
+
+    static bool classof (const Stmt* S) {
+        return S->getKind () == SK_Raise;
+    }
+
+    private:
+    ExceptionDecl* Exc;
+};
+
+/**
+ * A handler of a TRY statement: the statements run for one exception.
+ */
+struct ExceptHandler {
+    ExceptionDecl* Exc;
+    StmtList Stmts;
+};
+
+using HandlerList = std::vector<ExceptHandler>;
+
+/**
+ * Represents a try statement in the abstract syntax tree (AST).
+ * An exception raised while the statements run, and not handled further
+ * inside, continues in the handler for it, or in the ELSE part, which handles
+ * every exception. Otherwise it propagates out of the TRY statement.
+ *
+ * Example: `TRY Find (x) EXCEPT NotFound: x := 0 | Overflow: x := -1 END`
+ */
+class TryStatement : public Stmt {
+    public:
+    TryStatement (llvm::SMLoc Loc, StmtList& Stmts, HandlerList& Handlers, StmtList& ElseStmts, bool HasElse)
+    : Stmt (SK_Try, Loc), Stmts (Stmts), Handlers (Handlers), ElseStmts (ElseStmts),
+      HasElse (HasElse) {
+    }
+
+    const StmtList& getStmts () {
+        return Stmts;
+    }
+    const HandlerList& getHandlers () {
+        return Handlers;
+    }
+    const StmtList& getElseStmts () {
+        return ElseStmts;
+    }
+    bool hasElse () const {
+        return HasElse;
+    }
+
+    static bool classof (const Stmt* S) {
+        return S->getKind () == SK_Try;
+    }
+
+    private:
+    StmtList Stmts;
+    HandlerList Handlers;
+    StmtList ElseStmts;
+    bool HasElse; // An empty ELSE part still handles every exception
+};
+
 } // namespace amanlang
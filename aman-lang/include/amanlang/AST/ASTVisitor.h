@@ -0,0 +1,113 @@
+#pragma once
+
+#include "amanlang/AST/AST.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/ErrorHandling.h"
+
+/**
+ * CRTP visitors over the AST, in the style of Clang's StmtVisitor.
+ *
+ * `visit` switches on the node kind once and calls `visit<Class>` on the
+ * derived class, e.g. `visitInfixExpression (InfixExpression*)`. A derived
+ * class only defines the methods it cares about; every other node falls back
+ * to `visitExpr`/`visitStmt`/`visitDecl`, which return `RetTy ()` unless
+ * overridden. The dispatch is static, so it can be inlined.
+ *
+ * @example
+ * class ConstantFolder : public ExprVisitor<ConstantFolder, std::optional<int64_t>> {
+ *     public:
+ *     std::optional<int64_t> visitIntegerLiteral (IntegerLiteral* E);
+ *     std::optional<int64_t> visitInfixExpression (InfixExpression* E);
+ * };
+ */
+namespace amanlang {
+
+template <typename Derived, typename RetTy = void> class ExprVisitor {
+    public:
+    RetTy visit (Expr* E) {
+        switch (E->getKind ()) {
+#define EXPR(KIND, CLASS) \
+    case Expr::EK_##KIND: return derived ().visit##CLASS (llvm::cast<CLASS> (E));
+#include "amanlang/AST/ASTNodes.def"
+        case Expr::EK_Var: break; // No longer created, see Designator
+        }
+        llvm_unreachable ("Unknown expression kind");
+    }
+
+#define EXPR(KIND, CLASS)                  \
+    RetTy visit##CLASS (CLASS* E) {        \
+        return derived ().visitExpr (E);   \
+    }
+#include "amanlang/AST/ASTNodes.def"
+
+    RetTy visitExpr (Expr*) {
+        return RetTy ();
+    }
+
+    private:
+    Derived& derived () {
+        return *static_cast<Derived*> (this);
+    }
+};
+
+template <typename Derived, typename RetTy = void> class StmtVisitor {
+    public:
+    RetTy visit (Stmt* S) {
+        switch (S->getKind ()) {
+#define STMT(KIND, CLASS) \
+    case Stmt::SK_##KIND: return derived ().visit##CLASS (llvm::cast<CLASS> (S));
+#include "amanlang/AST/ASTNodes.def"
+        }
+        llvm_unreachable ("Unknown statement kind");
+    }
+
+    // Visits a statement sequence in order.
+    void visit (const StmtList& Stmts) {
+        for (Stmt* S : Stmts)
+            derived ().visit (S);
+    }
+
+#define STMT(KIND, CLASS)                  \
+    RetTy visit##CLASS (CLASS* S) {        \
+        return derived ().visitStmt (S);   \
+    }
+#include "amanlang/AST/ASTNodes.def"
+
+    RetTy visitStmt (Stmt*) {
+        return RetTy ();
+    }
+
+    private:
+    Derived& derived () {
+        return *static_cast<Derived*> (this);
+    }
+};
+
+template <typename Derived, typename RetTy = void> class DeclVisitor {
+    public:
+    RetTy visit (Decl* D) {
+        switch (D->getKind ()) {
+#define DECL(KIND, CLASS) \
+    case Decl::DK_##KIND: return derived ().visit##CLASS (llvm::cast<CLASS> (D));
+#include "amanlang/AST/ASTNodes.def"
+        }
+        llvm_unreachable ("Unknown declaration kind");
+    }
+
+#define DECL(KIND, CLASS)                  \
+    RetTy visit##CLASS (CLASS* D) {        \
+        return derived ().visitDecl (D);   \
+    }
+#include "amanlang/AST/ASTNodes.def"
+
+    RetTy visitDecl (Decl*) {
+        return RetTy ();
+    }
+
+    private:
+    Derived& derived () {
+        return *static_cast<Derived*> (this);
+    }
+};
+
+} // namespace amanlang
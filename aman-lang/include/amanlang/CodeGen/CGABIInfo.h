@@ -0,0 +1,91 @@
+#pragma once
+#include "amanlang/AST/AST.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/Support/Alignment.h>
+#include <memory>
+
+namespace amanlang {
+
+class CGModule;
+
+// How a value parameter or the result of a procedure crosses the call.
+class ABIArgInfo {
+    public:
+    enum Kind {
+        Direct,   // As the IR value of its type
+        Coerce,   // A small aggregate, as an integer of the same size
+        Indirect, // By address: a byval argument, or an sret result
+    };
+
+    static ABIArgInfo getDirect (llvm::Type* Ty) {
+        return ABIArgInfo (Direct, Ty, Ty, llvm::Align ());
+    }
+    static ABIArgInfo getCoerce (llvm::Type* Ty, llvm::IntegerType* IntTy) {
+        return ABIArgInfo (Coerce, Ty, IntTy, llvm::Align ());
+    }
+    static ABIArgInfo getIndirect (llvm::Type* Ty, llvm::PointerType* PtrTy, llvm::Align Alignment) {
+        return ABIArgInfo (Indirect, Ty, PtrTy, Alignment);
+    }
+
+    Kind getKind () const {
+        return K;
+    }
+    bool isCoerce () const {
+        return K == Coerce;
+    }
+    bool isIndirect () const {
+        return K == Indirect;
+    }
+    // The type of the value in the procedure.
+    llvm::Type* getType () const {
+        return Ty;
+    }
+    // The type of the IR argument or result.
+    llvm::Type* getIRType () const {
+        return IRTy;
+    }
+    llvm::Align getAlign () const {
+        return Alignment;
+    }
+
+    private:
+    ABIArgInfo (Kind K, llvm::Type* Ty, llvm::Type* IRTy, llvm::Align Alignment)
+    : K (K), Ty (Ty), IRTy (IRTy), Alignment (Alignment) {
+    }
+
+    Kind K;
+    llvm::Type* Ty;
+    llvm::Type* IRTy;
+    llvm::Align Alignment;
+};
+
+// The lowered signature of a procedure. An sret result takes the first IR
+// argument; an open array takes two, its address and its length.
+struct ABIFunctionInfo {
+    ABIArgInfo Ret = ABIArgInfo::getDirect (nullptr);
+    llvm::SmallVector<ABIArgInfo, 8> Params; // One per formal parameter
+    llvm::FunctionType* FnTy                 = nullptr;
+};
+
+// Lowers records and arrays in signatures. Passing them as first-class
+// aggregates makes the backend shuffle every element through registers or
+// the stack. Instead, aggregates of up to two pointers in size travel as one
+// integer, and larger ones by address: byval arguments and sret results.
+// The classification only depends on the type and the target's DataLayout,
+// so separately generated modules agree on it.
+class CGABIInfo {
+    public:
+    explicit CGABIInfo (CGModule& CGM);
+
+    const ABIFunctionInfo& getFunctionInfo (ProcedureDecl* Proc);
+    ABIArgInfo classify (llvm::Type* Ty);
+
+    private:
+    CGModule& CGM;
+
+    llvm::DenseMap<ProcedureDecl*, std::unique_ptr<ABIFunctionInfo>> FunctionInfos;
+};
+
+} // namespace amanlang
@@ -11,24 +11,35 @@ namespace amanlang {
 
 class CGDebugInfo {
     public:
-    explicit CGDebugInfo (CGModule& CGM);
+    // With LineTablesOnly, only subprograms and locations are emitted; no
+    // types and no variables.
+    CGDebugInfo (CGModule& CGM, llvm::DICompileUnit::DebugEmissionKind Kind);
 
     // Emissions
-    void emit (VariableDecl* Decl, llvm::GlobalVariable* V);
+    void emit (VariableDecl* Decl, llvm::GlobalVariable* V, uint64_t Offset = 0);
     void emit (ProcedureDecl* Decl, llvm::Function* Fn);
     void emitEnd (ProcedureDecl* Decl, llvm::Function* Fn); // emitProcedureEnd
 
     llvm::DILocalVariable*
-    emit (FormalParameterDecl* FP, size_t Idx, llvm::Value* Val, llvm::BasicBlock* BB);
+    emit (FormalParameterDecl* FP, size_t Idx, llvm::Value* Val, llvm::BasicBlock* BB, bool InMemory = false);
     void emit (llvm::Value* Val, llvm::DILocalVariable* Var, llvm::SMLoc Loc, llvm::BasicBlock* BB);
 
+    llvm::DebugLoc getDebugLoc (llvm::SMLoc Loc);
+    void finalize ();
+
     private:
     CGModule& CGM;
 
     llvm::DIBuilder Builder;
     llvm::DICompileUnit* CU;
+    bool LineTablesOnly;
 
+    // Every node is built once per module.
     llvm::DenseMap<TypeDecl*, llvm::DIType*> TypeCache;
+    llvm::DenseMap<TypeDecl*, llvm::DIType*> RefTypeCache; // VAR parameters
+    llvm::DenseMap<ProcedureDecl*, llvm::DISubroutineType*> SubroutineCache;
+    llvm::DIType* VoidType                    = nullptr;
+    llvm::DISubroutineType* EmptySubroutineTy = nullptr; // -gline-tables-only
     llvm::SmallVector<llvm::DIScope*, 4> ScopeStack;
 
 
@@ -37,8 +48,6 @@ class CGDebugInfo {
     void openScope (llvm::DIScope*);
     void closeScope ();
     unsigned getLineNumber (llvm::SMLoc Loc);
-    llvm::DebugLoc getDebugLoc (llvm::SMLoc Loc);
-    void finalize ();
 
 
     // Type Retrieval
@@ -47,6 +56,8 @@ class CGDebugInfo {
     llvm::DIType* getType (ArrayTypeDecl* Ty);     // ArrayType
     llvm::DIType* getType (RecordTypeDecl* Ty);    // RecordType
     llvm::DIType* getType (TypeDecl* Type);
+    llvm::DIType* getReferenceType (TypeDecl* Type);
+    llvm::DIType* getParamType (FormalParameterDecl* FP);
 
     llvm::DISubroutineType* getType (ProcedureDecl* P);
 };
@@ -1,55 +1,40 @@
 #pragma once
-#include <llvm/IR/IRBuilder.h>
+#include "amanlang/AST/AST.h"
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/Module.h>
 
 namespace amanlang {
 
+class CGModule;
+
+// Exceptions follow the Itanium C++ ABI: RAISE throws with __cxa_throw, and
+// __gxx_personality_v0 finds the handlers through the unwind tables. Code
+// that doesn't raise pays nothing; only calls inside a TRY statement become
+// invokes.
 class CGEh {
     public:
-    explicit CGEh (llvm::Module* M);
-
-    // Cache types
-    llvm::Type* VoidTy;
-    llvm::Type* Int8Ty;
-    llvm::Type* Int32Ty;
-    llvm::Type* Int64Ty;
-    llvm::PointerType* Int8PtrTy;
-    llvm::PointerType* Int32PtrTy;
-    llvm::PointerType* Int8PtrPtrTy;
-    llvm::Constant* Int32Zero;
+    explicit CGEh (CGModule& CGM);
 
-    private:
-    llvm::Module* M;
-    llvm::LLVMContext& Ctx;
-    llvm::IRBuilder<> Builder;
-
-    llvm::GlobalVariable* TypeInfo;
-    llvm::FunctionType* AllocEHFty;
-    llvm::Function* AllocEHFn;
-    llvm::FunctionType* ThrowEHFty;
-    llvm::Function* ThrowEHFn;
-    llvm::BasicBlock* LPadBB;
-    llvm::BasicBlock* UnreachableBB;
-
-    // Create IR utils
-    void createFunc (llvm::FunctionType*& Fty,
-    llvm::Function*& Fn,
-    const llvm::Twine& N,
-    llvm::Type* Result,
-    llvm::ArrayRef<llvm::Type*> Params = std::nullopt,
-    bool IsVarArgs                     = false);
+    // The std::type_info object identifying an exception. It is linkonce_odr,
+    // so that separately generated modules agree on its address.
+    llvm::GlobalVariable* getTypeInfo (ExceptionDecl* Exc);
 
-    void createICmpEq (llvm::Value* Left,
-    llvm::Value* Right,
-    llvm::BasicBlock*& TrueDest,
-    llvm::BasicBlock*& FalseDest,
-    const llvm::Twine& TrueLabel  = "",
-    const llvm::Twine& FalseLabel = "");
+    // Runtime functions
+    llvm::FunctionCallee getAllocateExceptionFn ();
+    llvm::FunctionCallee getThrowFn ();
+    llvm::FunctionCallee getBeginCatchFn ();
+    llvm::FunctionCallee getEndCatchFn ();
+    llvm::Function* getPersonalityFn ();
 
+    private:
+    CGModule& CGM;
+
+    llvm::DenseMap<ExceptionDecl*, llvm::GlobalVariable*> TypeInfos;
 
-    // Generic Eh utils
-    void addThrow (int PayloadVal);
-    void addLandingPad ();
+    llvm::Function* getRuntimeFn (llvm::StringRef Name,
+    llvm::Type* Result,
+    llvm::ArrayRef<llvm::Type*> Params,
+    bool IsVarArgs = false);
 };
 
-} // namespace amanlang
\ No newline at end of file
+} // namespace amanlang
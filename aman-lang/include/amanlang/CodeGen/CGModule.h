@@ -2,29 +2,39 @@
 
 #include "amanlang/AST/AST.h"
 #include "amanlang/AST/ASTCtx.h"
+#include "amanlang/CodeGen/CGABIInfo.h"
+#include "amanlang/CodeGen/CGEh.h"
 #include "amanlang/CodeGen/CGTbaa.h"
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
+#include <memory>
 
 namespace amanlang {
 
+class CGDebugInfo;
+
 class CGModule {
     public:
-    CGModule (llvm::Module* M, ASTContext& ASTCtx)
-    : M (M), ASTCtx (ASTCtx), Tbaa (*this) {
-        initialize ();
-    }
+    CGModule (llvm::Module* M, ASTContext& ASTCtx);
+    ~CGModule ();
 
     // Cache types
     llvm::Type* VoidTy;
     llvm::Type* Int1Ty;
     llvm::Type* Int32Ty;
     llvm::Type* Int64Ty;
+    llvm::PointerType* PtrTy;
     llvm::Constant* Int32Zero;
 
     void initialize ();
     void run (ModuleDecl* Mod);
 
+    // The pieces of run (), for generating procedures in separate modules.
+    // Without Definitions, globals are only declared, to be resolved by the
+    // module that is linked with the partial one.
+    void emitGlobals (ModuleDecl* Mod, bool Definitions = true);
+    void emitProcedure (ProcedureDecl* Proc);
+
     // getters
     constexpr LLVM_ATTRIBUTE_ALWAYS_INLINE auto& getLLVMCtx () {
         return M->getContext ();
@@ -44,21 +54,70 @@ class CGModule {
         return ASTCtx;
     }
 
+    CGEh& getEh () {
+        return Eh;
+    }
+
+    CGABIInfo& getABIInfo () {
+        return ABI;
+    }
+
+    // Null unless -g or -gline-tables-only is given.
+    CGDebugInfo* getDbgInfo () {
+        return DebugInfo.get ();
+    }
+
     llvm::Type* convertType (TypeDecl* Ty);
     std::string mangleName (Decl* D);
 
+    // A structured constant lives in a read-only global, which is created on
+    // first use. emitConstant builds the value of a folded constant expression.
+    llvm::GlobalVariable* getConstant (ConstantDecl* C);
+    llvm::Constant* emitConstant (Expr* E);
+
+    // The struct element of the field with the given index in declaration
+    // order; -freorder-record-fields lays the fields out in another order.
+    unsigned getFieldIndex (RecordTypeDecl* Ty, unsigned Index);
+
+    // Alias information for loads and stores. A VAR parameter can only refer
+    // to a module variable that is passed as VAR argument somewhere in the
+    // module, as the module variables are private. Accesses to all the others
+    // get a scope that is disjoint from the one of the VAR parameters.
+    enum AliasScopeKind { AS_VarParams, AS_Globals };
+    void decorateInst (llvm::Instruction* Inst, TypeDecl* Type, TypeDecl* Base = nullptr, uint64_t Offset = 0);
+    void addAliasScope (llvm::Instruction* Inst, AliasScopeKind Kind);
+
+    // `void __aman_check_failed (i32 Site)` of the runtime, which reports a
+    // failed runtime check and aborts.
+    llvm::FunctionCallee getCheckFailedFn ();
+
+    // `ptr __aman_new (i64 Size)` and `void __aman_dispose (ptr, i64 Size)`
+    // of the runtime's pooled heap, which back NEW and DISPOSE.
+    llvm::FunctionCallee getNewFn ();
+    llvm::FunctionCallee getDisposeFn ();
+
     private:
     llvm::Module* M;
     ModuleDecl* ModDecl;
 
-    // Repository of global objects.
-    llvm::DenseMap<Decl*, llvm::GlobalObject*> Globals;
+    // Repository of global objects. With -fpack-globals, the address of a
+    // module variable is an element of the module's variable block.
+    llvm::DenseMap<Decl*, llvm::Constant*> Globals;
+    llvm::DenseMap<ConstantDecl*, llvm::GlobalVariable*> Constants;
     llvm::DenseMap<TypeDecl*, llvm::Type*> TypeCache;
+    llvm::DenseMap<RecordTypeDecl*, llvm::SmallVector<unsigned, 8>> FieldIndices;
 
     ASTContext& ASTCtx;
 
     // Ch.6
     CGTbaa Tbaa;
-    void decorateInst (llvm::Instruction* Inst, TypeDecl* Type);
+    CGEh Eh;
+    CGABIInfo ABI;
+    llvm::MDNode* AliasScopes[2] = {};
+
+    void reportRecordLayouts (const DeclList& Decls);
+    void emitGlobalBlock (ModuleDecl* Mod, llvm::ArrayRef<VariableDecl*> Vars, bool Definitions);
+
+    std::unique_ptr<CGDebugInfo> DebugInfo;
 };
 } // namespace amanlang
\ No newline at end of file
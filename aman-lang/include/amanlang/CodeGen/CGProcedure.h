@@ -2,47 +2,39 @@
 
 
 #include "amanlang/AST/AST.h"
+#include "amanlang/AST/ASTVisitor.h"
 #include "amanlang/CodeGen/CGModule.h"
+#include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/IR/IRBuilder.h>
-#include <variant>
+#include <optional>
 
 namespace llvm {
-
-template <> struct DenseMapInfo<BasicBlock*> {
-    static inline BasicBlock* getEmptyKey () {
-        return reinterpret_cast<BasicBlock*> (0);
-    }
-    static inline BasicBlock* getTombstoneKey () {
-        return reinterpret_cast<BasicBlock*> (-1);
-    }
-    static unsigned getHashValue (const BasicBlock* BB) {
-        return reinterpret_cast<uintptr_t> (BB);
-    }
-    static bool isEqual (const BasicBlock* LHS, const BasicBlock* RHS) {
-        return LHS == RHS;
-    }
-};
-
+class DominatorTree;
 } // end namespace llvm
 
 namespace amanlang {
 
-class CGProcedure {
+class CGProcedure : public ExprVisitor<CGProcedure, llvm::Value*>,
+                    public StmtVisitor<CGProcedure, llvm::Value*> {
+    friend class ExprVisitor<CGProcedure, llvm::Value*>;
+    friend class StmtVisitor<CGProcedure, llvm::Value*>;
 
-    struct BasicBlock {
-        llvm::DenseMap<Decl*, llvm::TrackingVH<llvm::Value>> Defs; // Map Var -> defintion
-        llvm::DenseMap<llvm::PHINode*, Decl*> IncompletePhis; // Map Phi -> Decl
+    struct BlockInfo {
+        // Slot -> definition. Tracking handles follow phis that optimizePhi replaces.
+        llvm::SmallVector<llvm::TrackingVH<llvm::Value>, 0> Defs;
+        llvm::SmallVector<std::pair<llvm::PHINode*, unsigned>, 4> IncompletePhis; // Phi, Slot
 
         unsigned Sealed : 1; // Block is sealed => no more predesscors
-        BasicBlock () : Sealed (0) {
+        BlockInfo () : Sealed (0) {
         }
     };
 
-    using ExprVariant =
-    std::variant<InfixExpression*, PrefixExpression*, Designator*, ConstantAccess*, IntegerLiteral*, BooleanLiteral*>;
-
-    using StmtVariant =
-    std::variant<AssignmentStatement*, ProcedureCallStatement*, IfStatement*, WhileStatement*, ReturnStatement*, StmtList&>;
+    // The memory a designator selects, for TBAA and alias scopes.
+    struct MemAccess {
+        TypeDecl* Base  = nullptr; // Record whose field is accessed
+        uint64_t Offset = 0;       // Byte offset of the field in Base
+        std::optional<CGModule::AliasScopeKind> Scope;
+    };
 
     public:
     explicit CGProcedure (CGModule& CGM)
@@ -59,31 +51,47 @@ class CGProcedure {
         Builder.SetInsertPoint (BB);
     }
 
+    using ExprVisitor<CGProcedure, llvm::Value*>::visit;
+    using StmtVisitor<CGProcedure, llvm::Value*>::visit;
+
+    // Attaches the location of each statement to the instructions it emits.
+    llvm::Value* visit (Stmt* S);
+
     // Expr => Value
-    llvm::Value* operator() (Expr* expr);
-    llvm::Value* operator() (InfixExpression* expr);
-    llvm::Value* operator() (PrefixExpression* expr);
-    llvm::Value* operator() (Designator* expr) {
-        auto* D = expr->getDecl ();
-        return readVariable (CurrBlk, D);
+    llvm::Value* visitInfixExpression (InfixExpression* expr);
+    llvm::Value* visitPrefixExpression (PrefixExpression* expr);
+    llvm::Value* visitDesignator (Designator* expr);
+    llvm::Value* visitFunctionCallExpr (FunctionCallExpr* expr);
+    llvm::Value* visitConversionExpr (ConversionExpr* expr);
+    llvm::Value* visitHighExpr (HighExpr* expr);
+    llvm::Value* visitAggregateLiteral (AggregateLiteral* expr) {
+        return CGM.emitConstant (expr);
     }
-    llvm::Value* operator() (ConstantAccess* expr) {
-        return this->operator() (expr->geDecl ()->getExpr ());
+    llvm::Value* visitConstantAccess (ConstantAccess* expr) {
+        return visit (expr->geDecl ()->getExpr ());
     }
-    LLVM_ATTRIBUTE_ALWAYS_INLINE llvm::Value* operator() (IntegerLiteral* expr) {
-        return llvm::ConstantInt::get (CGM.Int64Ty, expr->getValue ());
+    LLVM_ATTRIBUTE_ALWAYS_INLINE llvm::Value* visitIntegerLiteral (IntegerLiteral* expr) {
+        return llvm::ConstantInt::get (CGM.convertType (expr->getType ()), expr->getValue ());
     }
-    LLVM_ATTRIBUTE_ALWAYS_INLINE llvm::Value* operator() (BooleanLiteral* expr) {
+    LLVM_ATTRIBUTE_ALWAYS_INLINE llvm::Value* visitRealLiteral (RealLiteral* expr) {
+        return llvm::ConstantFP::get (CGM.getLLVMCtx (), expr->getValue ());
+    }
+    LLVM_ATTRIBUTE_ALWAYS_INLINE llvm::Value* visitBooleanLiteral (BooleanLiteral* expr) {
         return llvm::ConstantInt::get (CGM.Int1Ty, expr->getValue ());
     }
 
     // Stmt => Value
-    llvm::Value* operator() (const StmtList& Stmts);
-    llvm::Value* operator() (AssignmentStatement* Stmt);
-    llvm::Value* operator() (ProcedureCallStatement* Stmt);
-    llvm::Value* operator() (IfStatement* Stmt);
-    llvm::Value* operator() (WhileStatement* Stmt);
-    llvm::Value* operator() (ReturnStatement* Stmt);
+    llvm::Value* visitAssignmentStatement (AssignmentStatement* Stmt);
+    llvm::Value* visitProcedureCallStatement (ProcedureCallStatement* Stmt);
+    llvm::Value* visitIfStatement (IfStatement* Stmt);
+    llvm::Value* visitCaseStatement (CaseStatement* Stmt);
+    llvm::Value* visitWhileStatement (WhileStatement* Stmt);
+    llvm::Value* visitForStatement (ForStatement* Stmt);
+    llvm::Value* visitReturnStatement (ReturnStatement* Stmt);
+    llvm::Value* visitNewStatement (NewStatement* Stmt);
+    llvm::Value* visitDisposeStatement (DisposeStatement* Stmt);
+    llvm::Value* visitRaiseStatement (RaiseStatement* Stmt);
+    llvm::Value* visitTryStatement (TryStatement* Stmt);
 
     private:
     CGModule& CGM;
@@ -94,9 +102,46 @@ class CGProcedure {
 
     llvm::Function* Function;
     llvm::FunctionType* FunType;
-
-    llvm::DenseMap<llvm::BasicBlock*, BasicBlock> BlockDefs;
+    const ABIFunctionInfo* FnInfo = nullptr;
+    llvm::Argument* SRetArg       = nullptr; // Where a large result is returned
+
+    // SSA construction: dense variable slots and per-block definition tables.
+    llvm::DenseMap<Decl*, unsigned> VarSlots;
+    llvm::SmallVector<llvm::Type*, 16> SlotTypes;
+    llvm::DenseMap<llvm::BasicBlock*, unsigned> BlockNumbers;
+    llvm::SmallVector<BlockInfo, 0> Blocks; // moves, not copies, the handles on growth
     llvm::DenseMap<FormalParameterDecl*, llvm::Argument*> FormalParams;
+    // An open array is passed as the address of its first element, followed
+    // by its length.
+    llvm::DenseMap<FormalParameterDecl*, llvm::Argument*> OpenArrayLengths;
+    // Variables and value parameters of aggregate type live in stack slots,
+    // or in the caller's byval copy.
+    llvm::DenseMap<Decl*, llvm::Value*> Addresses;
+    // The GEPs of designators emitted in a block, by block and base address,
+    // so a component selected again reuses its address. See emitInBoundsGEP.
+    llvm::DenseMap<std::pair<llvm::BasicBlock*, llvm::Value*>, llvm::SmallVector<llvm::GetElementPtrInst*, 2>>
+    AddressCache;
+
+    // Runtime checks: the shared cold failure block, which receives the site
+    // of the failed check in TrapSite, and the emitted bounds checks.
+    llvm::BasicBlock* TrapBlock = nullptr;
+    llvm::PHINode* TrapSite     = nullptr;
+    llvm::SmallVector<llvm::BranchInst*, 8> BoundsChecks;
+    // The values a FOR control variable takes in the loop body, [Lower, Upper],
+    // where the bounds of the statement are constant. See isIndexInRange.
+    llvm::DenseMap<llvm::Value*, std::pair<int64_t, int64_t>> InductionRanges;
+    llvm::SMLoc CurLoc; // Of the statement being emitted
+
+    // The TRY statements around the code being emitted, innermost last. The
+    // handler blocks exist before the body is emitted, because the landing
+    // pads of nested TRY statements branch to them.
+    struct TryScope {
+        TryStatement* Stmt;
+        llvm::BasicBlock* LandingPad = nullptr; // Created by the first invoke
+        llvm::SmallVector<llvm::BasicBlock*, 4> HandlerBlocks;
+        llvm::BasicBlock* ElseBlock = nullptr;
+    };
+    llvm::SmallVector<TryScope*, 4> TryScopes;
     // descriptor for an auto variable, which is a local variable that is not a subprogram parameter
     llvm::DenseMap<Decl*, llvm::DILocalVariable*> DIVariables; // Ch.5
 
@@ -105,23 +150,67 @@ class CGProcedure {
     llvm::Value* readVariable (llvm::BasicBlock* BB, Decl* Decl, bool LoadVal = true);
 
     // Read/Write Local Vars
-    void writeLocalVariable (llvm::BasicBlock* BB, Decl* Decl, llvm::Value* Val);
-    llvm::Value* readLocalVariable (llvm::BasicBlock* BB, Decl* Decl);
-    llvm::Value* readLocalVariableRecursive (llvm::BasicBlock* BB, Decl* Decl);
+    unsigned addSlot (Decl* D, llvm::Type* Ty);
+    unsigned getSlot (Decl* D);
+    unsigned getBlockNumber (llvm::BasicBlock* BB);
+    void writeLocalVariable (llvm::BasicBlock* BB, unsigned Slot, llvm::Value* Val);
+    llvm::Value* readLocalVariable (llvm::BasicBlock* BB, unsigned Slot);
+    llvm::Value* readLocalVariableRecursive (llvm::BasicBlock* BB, unsigned Slot);
 
     // PHINode Manupulation
-    llvm::PHINode* addEmptyPhi (llvm::BasicBlock* BB, Decl* Decl);
-    llvm::Value* addPhiOperands (llvm::BasicBlock* BB, Decl* Decl, llvm::PHINode* Phi);
+    llvm::PHINode* addEmptyPhi (llvm::BasicBlock* BB, unsigned Slot);
+    llvm::Value* addPhiOperands (llvm::BasicBlock* BB, unsigned Slot, llvm::PHINode* Phi);
     llvm::Value* optimizePhi (llvm::PHINode* Phi);
 
     // Create Function from our AST's ProcedureDecl
     llvm::FunctionType* createFunctionType (ProcedureDecl* Proc);
     llvm::Function* createFunction (ProcedureDecl* Proc, llvm::FunctionType* FTy);
+    void addEffectAttributes (llvm::Function* Fn, const ProcedureEffects& Effects);
+    static bool isNoAliasOpenArray (ProcedureDecl* Proc, FormalParameterDecl* FP);
 
     // Utils
     llvm::Type* mapType (Decl* Decl);
     void sealBlock (llvm::BasicBlock* BB);
-    llvm::Value* _handleDesignator(Designator* Var); // ch.5
+    bool isInMemory (Decl* D);
+    TypeDecl* getDeclType (Decl* D);
+    llvm::Value* emitDesignatorAddress (Designator* Desig, MemAccess& Access); // ch.5
+    llvm::Value* emitInBoundsGEP (llvm::Type* Ty, llvm::Value* Addr, llvm::ArrayRef<llvm::Value*> Indices);
+    void emitStore (Designator* Desig, llvm::Value* Val);
+    llvm::MDNode* createLoopMetadata ();
+    std::optional<CGModule::AliasScopeKind> getAliasScope (Decl* D);
+    void decorateAccess (llvm::Instruction* Inst, TypeDecl* Ty, const MemAccess& Access);
+
+    // Calls and Exceptions
+    llvm::Value* emitCall (ProcedureDecl* Proc, const ExprList& Args);
+    void emitOpenArrayArg (Designator* Desig, llvm::SmallVectorImpl<llvm::Value*>& ArgVals);
+    void markTailCall (llvm::Value* V);
+    llvm::Value* emitAggregateAddress (Expr* E);
+    llvm::Value* loadCoerced (llvm::Value* Addr, const ABIArgInfo& AI);
+    void storeCoerced (llvm::Value* Val, llvm::Value* Addr, const ABIArgInfo& AI);
+    llvm::AllocaInst* createTemporary (llvm::Type* Ty, const llvm::Twine& Name);
+    llvm::CallBase* createCallOrInvoke (llvm::FunctionCallee Callee, llvm::ArrayRef<llvm::Value*> Args);
+    void emitLandingPad (llvm::BasicBlock* LandingPad);
+
+    // Real arithmetic
+    llvm::Value* emitRealInfix (InfixExpression* E);
+    llvm::Value* emitFMulAdd (InfixExpression* E, bool IsSub);
+
+    // Short-circuit evaluation of AND and OR
+    llvm::Value* emitShortCircuit (InfixExpression* E, bool IsAnd);
+    bool isCheapOperand (Expr* E, unsigned Budget = 4);
+
+    // Runtime Checks
+    // The site ID passed to the runtime is `Line << 4 | Kind`.
+    enum CheckKind : uint32_t { CK_Bounds = 1, CK_DivByZero = 2, CK_Case = 3 };
+    llvm::ConstantInt* getCheckSite (CheckKind Kind);
+    llvm::BranchInst* emitCheck (llvm::Value* Ok, CheckKind Kind);
+    void emitBoundsCheck (llvm::Value* Idx, llvm::Value* Len);
+    void emitDivCheck (llvm::Value* Divisor);
+    llvm::BasicBlock* getTrapBlock ();
+    void eliminateBoundsChecks ();
+    bool isIndexInRange (llvm::Value* Idx, uint64_t Len, llvm::BasicBlock* BB, const llvm::DominatorTree& DT);
+    bool isKnownNonNegative (llvm::Value* V, llvm::SmallPtrSetImpl<llvm::PHINode*>& Visited);
+    void applyCondition (llvm::Value* Cond, bool IsTrue, llvm::Value* V, int64_t& Lower, int64_t& Upper);
 };
 
 } // namespace amanlang
\ No newline at end of file
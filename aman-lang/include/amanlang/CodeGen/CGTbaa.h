@@ -20,7 +20,9 @@ class CGTbaa {
     // complex-getters
     llvm::MDNode* getRoot ();
     llvm::MDNode* getTypeInfo (TypeDecl* Ty);
-    llvm::MDNode* getAccessTagInfo (TypeDecl* Ty);
+    // Tag for a scalar access of type Ty. With a Base record, the access is to
+    // the field at Offset bytes into it (struct-path TBAA).
+    llvm::MDNode* getAccessTagInfo (TypeDecl* Ty, TypeDecl* Base = nullptr, uint64_t Offset = 0);
 
     private:
     CGModule& CGM;
@@ -29,7 +31,7 @@ class CGTbaa {
     llvm::MDBuilder Builder;
 
     // The root node of the TBAA hierarchy
-    llvm::MDNode* Root;
+    llvm::MDNode* Root = nullptr;
 
 
     // Creating Scalar (offset 0) vs Struct-Type functionality
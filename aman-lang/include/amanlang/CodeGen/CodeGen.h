@@ -22,6 +22,8 @@ class CodeGen {
     : Ctx (Ctx), Machine (Machine), ASTCtx (ASTCtx) {};
 
     private:
+    void emitProceduresParallel (ModuleDecl* Decl, llvm::Module& M);
+
     llvm::LLVMContext& Ctx;
     llvm::TargetMachine& Machine;
     ASTContext& ASTCtx;
@@ -29,6 +29,7 @@ class Parser {
     bool parseDeclaration (DeclList& Decls);
     bool parseConstantDeclaration (DeclList& Decls);
     bool parseVariableDeclaration (DeclList& Decls);
+    bool parseExceptionDeclaration (DeclList& Decls);
     bool parseProcedureDeclaration (DeclList& ParentDecls);
     bool parseFormalParameters (FormalParamList& Params, Decl*& RetType);
     bool parseFormalParameterList (FormalParamList& Params);
@@ -44,8 +45,15 @@ class Parser {
     bool parseStatementSequence (StmtList& Stmts);
     bool parseStatement (StmtList& Stmts);
     bool parseIfStatement (StmtList& Stmts);
+    bool parseCaseStatement (StmtList& Stmts);
+    bool parseCase (CaseStatement* Case);
+    bool parseCaseLabel (CaseStatement* Case, CaseLabelList& Labels);
     bool parseWhileStatement (StmtList& Stmts);
+    bool parseForStatement (StmtList& Stmts);
     bool parseReturnStatement (StmtList& Stmts);
+    bool parseRaiseStatement (StmtList& Stmts);
+    bool parseTryStatement (StmtList& Stmts);
+    bool parseExceptHandler (HandlerList& Handlers);
 
     // Parser Expressions
     bool parseExprList (ExprList& Exprs);
@@ -60,6 +68,7 @@ class Parser {
     // Parser Terms
     bool parseTerm (Expr*& E);
     bool parseFactor (Expr*& E);
+    bool parseAggregate (ExprList& Elements);
     bool parseQualident (Decl*& D);
     bool parseIdentList (IdentList& Ids);
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "amanlang/AST/AST.h"
+#include "amanlang/AST/ASTVisitor.h"
+#include "llvm/ADT/APFloat.h"
+#include <cstdint>
+#include <optional>
+
+namespace amanlang {
+
+/**
+ * Folds the constant expressions that may appear where the language asks for
+ * a constant of an integer type: literals, named constants, their negation
+ * and `+`, `-`, `*`, DIV and MOD over them.
+ *
+ * An expression that is not such a constant yields `std::nullopt`, and so does
+ * one that overflows, divides by zero or is of an unsigned type.
+ */
+class ConstantEvaluator : public ExprVisitor<ConstantEvaluator, std::optional<int64_t>> {
+    friend class ExprVisitor<ConstantEvaluator, std::optional<int64_t>>;
+
+    public:
+    std::optional<int64_t> evaluate (Expr* E) {
+        return E ? visit (E) : std::nullopt;
+    }
+
+    private:
+    std::optional<int64_t> visitIntegerLiteral (IntegerLiteral* E);
+    std::optional<int64_t> visitConstantAccess (ConstantAccess* E);
+    std::optional<int64_t> visitPrefixExpression (PrefixExpression* E);
+    std::optional<int64_t> visitInfixExpression (InfixExpression* E);
+};
+
+/**
+ * Folds a constant of an integer or real type to a LONGREAL value.
+ *
+ * Real literals, named constants, negation and `+`, `-`, `*`, `/` are folded
+ * in double precision. A subexpression of an integer type is folded by the
+ * ConstantEvaluator and converted, so `2 * 3` and `N - 1` take a real type
+ * just like `6` does.
+ */
+class RealConstantEvaluator
+: public ExprVisitor<RealConstantEvaluator, std::optional<llvm::APFloat>> {
+    friend class ExprVisitor<RealConstantEvaluator, std::optional<llvm::APFloat>>;
+
+    public:
+    std::optional<llvm::APFloat> evaluate (Expr* E);
+
+    private:
+    std::optional<llvm::APFloat> visitRealLiteral (RealLiteral* E);
+    std::optional<llvm::APFloat> visitConstantAccess (ConstantAccess* E);
+    std::optional<llvm::APFloat> visitPrefixExpression (PrefixExpression* E);
+    std::optional<llvm::APFloat> visitInfixExpression (InfixExpression* E);
+};
+
+} // namespace amanlang
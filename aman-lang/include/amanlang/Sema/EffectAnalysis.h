@@ -0,0 +1,90 @@
+#pragma once
+
+#include "amanlang/AST/AST.h"
+#include "amanlang/AST/ASTVisitor.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include <vector>
+
+namespace amanlang {
+
+/**
+ * Computes the `ProcedureEffects` summary of every procedure in a module.
+ *
+ * Each procedure body is scanned once for the memory it touches itself and for
+ * the calls it makes. The call graph is then split into strongly connected
+ * components (Tarjan), which are produced callees first: a component only has
+ * to merge the already final summaries of its callees and iterate its own
+ * members to a fixpoint.
+ */
+class EffectAnalysis : public StmtVisitor<EffectAnalysis>, public ExprVisitor<EffectAnalysis> {
+    friend class StmtVisitor<EffectAnalysis>;
+    friend class ExprVisitor<EffectAnalysis>;
+
+    public:
+    void run (ModuleDecl* Mod);
+
+    private:
+    // Memory class of a designator, as seen from the procedure accessing it.
+    enum MemClass { MC_Local, MC_ArgMem, MC_Globals };
+
+    struct CallSite {
+        ProcedureDecl* Callee;
+        // Memory class of the actual argument of each VAR or open array formal
+        // parameter.
+        llvm::SmallVector<MemClass, 4> VarArgs;
+    };
+
+    struct Node {
+        ProcedureDecl* Proc;
+        ProcedureEffects Local; // Effects of the body, without its calls
+        llvm::SmallVector<CallSite, 4> Calls;
+
+        unsigned Index   = 0;
+        unsigned LowLink = 0;
+        bool Visited     = false;
+        bool OnStack     = false;
+    };
+
+    std::vector<Node> Nodes;
+    llvm::DenseMap<ProcedureDecl*, unsigned> NodeIds;
+    llvm::SmallVector<unsigned, 16> Stack;
+    unsigned NextIndex = 0;
+    Node* Cur          = nullptr; // The procedure whose body is scanned
+    unsigned TryDepth  = 0;       // TRY statements around the statement scanned
+
+    // Call graph construction
+    void collect (const DeclList& Decls);
+    void scanDesignator (Designator* D, ProcedureEffects::ModRef MR);
+    void scanIndices (Designator* D);
+    void scanCall (ProcedureDecl* Callee, const ExprList& Args);
+    MemClass classify (Designator* D);
+
+    using StmtVisitor<EffectAnalysis>::visit;
+    using ExprVisitor<EffectAnalysis>::visit;
+
+    void visitAssignmentStatement (AssignmentStatement* S);
+    void visitProcedureCallStatement (ProcedureCallStatement* S);
+    void visitIfStatement (IfStatement* S);
+    void visitCaseStatement (CaseStatement* S);
+    void visitWhileStatement (WhileStatement* S);
+    void visitForStatement (ForStatement* S);
+    void visitReturnStatement (ReturnStatement* S);
+    void visitNewStatement (NewStatement* S);
+    void visitDisposeStatement (DisposeStatement* S);
+    void visitRaiseStatement (RaiseStatement* S);
+    void visitTryStatement (TryStatement* S);
+
+    void visitInfixExpression (InfixExpression* E);
+    void visitPrefixExpression (PrefixExpression* E);
+    void visitDesignator (Designator* E);
+    void visitFunctionCallExpr (FunctionCallExpr* E);
+    void visitConversionExpr (ConversionExpr* E);
+
+    // Bottom-up propagation
+    void strongConnect (unsigned Id);
+    void summarize (llvm::ArrayRef<unsigned> SCC);
+};
+
+} // namespace amanlang
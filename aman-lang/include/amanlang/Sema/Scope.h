@@ -25,6 +25,11 @@ namespace amanlang {
             return Symbols.insert({ D->getName(), D }).second;
         }
 
+        // Makes D visible under another name as well, e.g. INT64 for INTEGER.
+        bool insert (llvm::StringRef Name, Decl* D) {
+            return Symbols.insert ({ Name, D }).second;
+        }
+
         Scope* getParent () const {
             return Parent;
         }
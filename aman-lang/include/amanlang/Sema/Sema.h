@@ -4,6 +4,7 @@
 #include "amanlang/Basic/Diagnostic.h"
 #include "amanlang/Basic/TokenKinds.h"
 #include "amanlang/Sema/Scope.h"
+#include "llvm/ADT/SmallPtrSet.h"
 
 namespace amanlang {
 class Sema {
@@ -29,8 +30,11 @@ class Sema {
     // Decls
     void actOnConstantDeclaration (DeclList& Decls, llvm::SMLoc Loc, llvm::StringRef Name, Expr* E);
     void actOnVariableDeclaration (DeclList& Decls, IdentList& Ids, Decl* D);
+    void actOnExceptionDeclaration (DeclList& Decls, IdentList& Ids);
     void actOnFormalParameterDeclaration (FormalParamList& Params, IdentList& Ids, Decl* D, bool IsVar);
+    TypeDecl* actOnOpenArrayType (llvm::SMLoc Loc, Decl* D);
     ProcedureDecl* actOnProcedureDeclaration (llvm::SMLoc Loc, llvm::StringRef Name);
+    void actOnExportMark (ProcedureDecl* ProcDecl, llvm::SMLoc Loc);
     void actOnProcedureDeclaration (ProcedureDecl* ProcDecl,
     llvm::SMLoc Loc,
     llvm::StringRef Name,
@@ -48,8 +52,22 @@ class Sema {
     void actOnAssignment (StmtList& Stmts, llvm::SMLoc Loc, Expr* D, Expr* E);
     void actOnProcCall (StmtList& Stmts, llvm::SMLoc Loc, Decl* D, ExprList& Params);
     void actOnIfStatement (StmtList& Stmts, llvm::SMLoc Loc, Expr* Cond, StmtList& IfStmts, StmtList& ElseStmts);
+    CaseStatement* actOnCaseStatement (llvm::SMLoc Loc, Expr* Selector);
+    void actOnCaseLabel (CaseStatement* Case, CaseLabelList& Labels, llvm::SMLoc Loc, Expr* Low, Expr* High);
+    void actOnCase (CaseStatement* Case, CaseLabelList& Labels, StmtList& CaseStmts);
+    void actOnCaseStatement (StmtList& Stmts, CaseStatement* Case, StmtList& ElseStmts, bool HasElse);
     void actOnWhileStatement (StmtList& Stmts, llvm::SMLoc Loc, Expr* Cond, StmtList& WhileStmts);
+    ForStatement* actOnForStatement (llvm::SMLoc Loc, Decl* D, Expr* Start, Expr* End, Expr* Step);
+    void actOnForStatement (StmtList& Stmts, ForStatement* For, StmtList& ForStmts);
     void actOnReturnStatement (StmtList& Stmts, llvm::SMLoc Loc, Expr* RetVal);
+    void actOnRaiseStatement (StmtList& Stmts, llvm::SMLoc Loc, Decl* D);
+    void actOnExceptHandler (HandlerList& Handlers, llvm::SMLoc Loc, Decl* D, StmtList& HandlerStmts);
+    void actOnTryStatement (StmtList& Stmts,
+    llvm::SMLoc Loc,
+    StmtList& TryStmts,
+    HandlerList& Handlers,
+    StmtList& ElseStmts,
+    bool HasElse);
 
     // Expr
     Expr* actOnExpression (Expr* Left, Expr* Right, const OperatorInfo& Op);
@@ -59,10 +77,12 @@ class Sema {
 
     // Literals and Identifiers
     Expr* actOnIntegerLiteral (llvm::SMLoc Loc, llvm::StringRef Literal);
+    Expr* actOnRealLiteral (llvm::SMLoc Loc, llvm::StringRef Literal);
     Expr* actOnFunctionCall (Decl* D, ExprList& Params);
     Decl* actOnQualIdentPart (Decl* Prev, llvm::SMLoc Loc, llvm::StringRef Name);
 
     Expr* actOnDesignator (Decl* D); // ch.5
+    Expr* actOnAggregate (llvm::SMLoc Loc, Decl* D, ExprList& Elements);
     void actOnIndexSelector(Expr *Desig, llvm::SMLoc Loc, Expr *E); // ch.5
     void actOnFieldSelector(Expr *Desig, llvm::SMLoc Loc, llvm::StringRef Name); // ch.5
     void actOnDereferenceSelector(Expr *Desig, llvm::SMLoc Loc); // ch.5
@@ -74,21 +94,49 @@ class Sema {
 
 
     /* Types  */
-    TypeDecl* IntegerType;
+    TypeDecl* IntegerType; // Also known as INT64
+    TypeDecl* Int8Type;
+    TypeDecl* Int16Type;
+    TypeDecl* Int32Type;
+    TypeDecl* CardinalType;
     TypeDecl* BooleanType;
+    TypeDecl* RealType;
+    TypeDecl* LongRealType;
+    ProcedureDecl* NewProc;
+    ProcedureDecl* DisposeProc;
+    ProcedureDecl* HighProc;
     BooleanLiteral* TrueLiteral;
     BooleanLiteral* FalseLiteral;
     ConstantDecl* TrueConst;
     ConstantDecl* FalseConst;
 
+    // Control variables of the FOR statements being parsed
+    llvm::SmallPtrSet<Decl*, 4> ForControlVars;
+
     void enterScope (Decl*);
     void leaveScope ();
 
     bool isOperatorForType (tok::TokenKind Op, TypeDecl* Ty);
+    bool evaluateConstant (Expr* E, int64_t& Value);
+    bool evaluateCaseLabel (Expr* E, TypeDecl* Ty, llvm::APSInt& Value);
+    bool evaluateRealConstant (Expr* E, llvm::APFloat& Value);
+    void checkAssignable (llvm::SMLoc Loc, Expr* E);
+
+    // Integer and real conversions
+    Expr* convertTo (Expr* E, TypeDecl* Ty);
+    Expr* convertToReal (Expr* E, TypeDecl* Ty);
+    RealLiteral* foldReal (Expr* E, TypeDecl* Ty);
+    bool convertOperands (Expr*& Left, Expr*& Right);
+    Expr* actOnConversion (TypeDecl* Ty, ExprList& Params);
+    void actOnNewOrDispose (StmtList& Stmts, llvm::SMLoc Loc, ProcedureDecl* Proc, ExprList& Params);
+    Expr* actOnHigh (llvm::SMLoc Loc, ExprList& Params);
+    bool isCompatibleOpenArray (OpenArrayTypeDecl* Formal, Expr* Arg);
+    bool checkAggregate (AggregateLiteral* Agg, TypeDecl* Ty);
+    Expr* foldElement (Expr* E, TypeDecl* Ty);
 
     void checkFormalAndActualParameters (llvm::SMLoc Loc,
     const FormalParamList& Formals,
-    const ExprList& Actuals);
+    ExprList& Actuals);
 };
 
 
@@ -0,0 +1,60 @@
+#include "amanlang/CodeGen/CGABIInfo.h"
+#include "amanlang/CodeGen/CGModule.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/Support/CommandLine.h"
+
+namespace amanlang {
+
+static llvm::cl::opt<unsigned> MaxCoerceSize ("fabi-coerce-size",
+llvm::cl::desc ("Largest aggregate in bytes passed as an integer (0 = two pointers)"),
+llvm::cl::init (0));
+
+CGABIInfo::CGABIInfo (CGModule& CGM) : CGM (CGM) {
+}
+
+ABIArgInfo CGABIInfo::classify (llvm::Type* Ty) {
+    if (!Ty->isAggregateType ())
+        return ABIArgInfo::getDirect (Ty);
+
+    const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
+    uint64_t Size              = DL.getTypeStoreSize (Ty).getFixedValue ();
+    uint64_t Limit             = MaxCoerceSize ? MaxCoerceSize : 2 * DL.getPointerSize ();
+    if (Size == 0)
+        return ABIArgInfo::getDirect (Ty);
+    if (Size <= Limit)
+        return ABIArgInfo::getCoerce (Ty, llvm::IntegerType::get (CGM.getLLVMCtx (), Size * 8));
+    return ABIArgInfo::getIndirect (Ty, CGM.PtrTy, DL.getABITypeAlign (Ty));
+}
+
+const ABIFunctionInfo& CGABIInfo::getFunctionInfo (ProcedureDecl* Proc) {
+    std::unique_ptr<ABIFunctionInfo>& Info = FunctionInfos[Proc];
+    if (Info)
+        return *Info;
+
+    Info = std::make_unique<ABIFunctionInfo> ();
+    llvm::SmallVector<llvm::Type*, 8> IRParams;
+    llvm::Type* IRRet = CGM.VoidTy;
+    if (TypeDecl* RetTy = Proc->getRetType ()) {
+        Info->Ret = classify (CGM.convertType (RetTy));
+        if (Info->Ret.isIndirect ())
+            IRParams.push_back (CGM.PtrTy);
+        else
+            IRRet = Info->Ret.getIRType ();
+    }
+
+    // VAR parameters and open arrays are passed by address anyway.
+    for (FormalParameterDecl* FP : Proc->getFormalParams ()) {
+        if (FP->isVar () || FP->isOpenArray ())
+            Info->Params.push_back (ABIArgInfo::getDirect (CGM.PtrTy));
+        else
+            Info->Params.push_back (classify (CGM.convertType (FP->getType ())));
+        IRParams.push_back (Info->Params.back ().getIRType ());
+        if (FP->isOpenArray ())
+            IRParams.push_back (CGM.Int64Ty); // Its length
+    }
+
+    Info->FnTy = llvm::FunctionType::get (IRRet, IRParams, false);
+    return *Info;
+}
+
+} // namespace amanlang
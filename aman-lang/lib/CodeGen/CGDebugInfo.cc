@@ -11,8 +11,9 @@ namespace amanlang {
 #pragma mark - CGDebugInfo (Initalization)
 /////////////////////////////////////////////////////////////////////////////
 
-CGDebugInfo::CGDebugInfo (CGModule& CGM)
-: CGM (CGM), Builder (*CGM.getModule ()) {
+CGDebugInfo::CGDebugInfo (CGModule& CGM, llvm::DICompileUnit::DebugEmissionKind Kind)
+: CGM (CGM), Builder (*CGM.getModule ()),
+  LineTablesOnly (Kind == llvm::DICompileUnit::DebugEmissionKind::LineTablesOnly) {
     llvm::SmallString<128> Path (CGM.getASTCtx ().getFilename ());
     llvm::sys::fs::make_absolute (Path);
 
@@ -21,7 +22,13 @@ CGDebugInfo::CGDebugInfo (CGModule& CGM)
 
     this->CU = Builder.createCompileUnit (llvm::dwarf::DW_LANG_Modula2, File, "amanlang",
     /* isOptimized */ false, StringRef (), /* ObjCRunTimeVersion */ 0, StringRef (),
-    /* EmissionKind */ llvm::DICompileUnit::DebugEmissionKind::FullDebug);
+    /* EmissionKind */ Kind);
+    openScope (CU);
+
+    // Without these flags, the backend drops the debug info again.
+    llvm::Module* M = CGM.getModule ();
+    M->addModuleFlag (llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+    M->addModuleFlag (llvm::Module::Max, "Dwarf Version", 5);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -29,13 +36,12 @@ CGDebugInfo::CGDebugInfo (CGModule& CGM)
 /////////////////////////////////////////////////////////////////////////////
 
 llvm::DIType* CGDebugInfo::getType (PervasiveTypeDecl* Ty) {
-    if (Ty->getName () == "INTEGER") {
-        return Builder.createBasicType (Ty->getName (), 64, llvm::dwarf::DW_ATE_signed);
-    }
-    if (Ty->getName () == "BOOLEAN") {
-        return Builder.createBasicType (Ty->getName (), 1, llvm::dwarf::DW_ATE_boolean);
-    }
-    llvm::report_fatal_error ("Unsupported pervasive type");
+    unsigned Encoding = llvm::dwarf::DW_ATE_boolean;
+    if (Ty->isInteger ())
+        Encoding = Ty->isSigned () ? llvm::dwarf::DW_ATE_signed : llvm::dwarf::DW_ATE_unsigned;
+    else if (Ty->isReal ())
+        Encoding = llvm::dwarf::DW_ATE_float;
+    return Builder.createBasicType (Ty->getName (), Ty->getBitWidth (), Encoding);
 }
 
 llvm::DIType* CGDebugInfo::getType (AliasTypeDecl* Ty) {
@@ -44,7 +50,6 @@ llvm::DIType* CGDebugInfo::getType (AliasTypeDecl* Ty) {
 }
 
 llvm::DIType* CGDebugInfo::getType (ArrayTypeDecl* Ty) {
-    // Convert
     auto* ATy = llvm::cast<llvm::ArrayType> (CGM.convertType (Ty));
     const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
 
@@ -56,55 +61,99 @@ llvm::DIType* CGDebugInfo::getType (ArrayTypeDecl* Ty) {
     llvm::SmallVector<llvm::Metadata*, 4> Subscripts;
     Subscripts.push_back (Builder.getOrCreateSubrange (0, NumElements));
 
-    return Builder.createArrayType (/* Size */ DL.getTypeSizeInBits (ATy) * 8,
-    /* Aligment in bits */ 1 << Log2 (DL.getABITypeAlign (ATy)),
+    return Builder.createArrayType (/* Size */ DL.getTypeSizeInBits (ATy),
+    /* Aligment in bits */ DL.getABITypeAlign (ATy).value () * 8,
     getType (Ty->getType ()), Builder.getOrCreateArray (Subscripts));
 }
 
 llvm::DIType* CGDebugInfo::getType (RecordTypeDecl* Ty) {
-    return nullptr;
+    auto* STy                  = llvm::cast<llvm::StructType> (CGM.convertType (Ty));
+    const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
+    const llvm::StructLayout* SL = DL.getStructLayout (STy);
+    unsigned Line                = getLineNumber (Ty->getLocation ());
+
+    // Members refer to the record as their scope, so it is created first.
+    llvm::DICompositeType* RecordTy = Builder.createStructType (getScope (), Ty->getName (),
+    CU->getFile (), Line, SL->getSizeInBits (), DL.getABITypeAlign (STy).value () * 8,
+    llvm::DINode::FlagZero, nullptr, llvm::DINodeArray ());
+    TypeCache[Ty] = RecordTy;
+
+    llvm::SmallVector<llvm::Metadata*, 4> Members;
+    const FieldList& Fields = Ty->getFields ();
+    for (unsigned I = 0, E = Fields.size (); I != E; ++I) {
+        unsigned Elem   = CGM.getFieldIndex (Ty, I);
+        llvm::Type* FTy = STy->getElementType (Elem);
+        Members.push_back (Builder.createMemberType (RecordTy, Fields[I].getName (),
+        CU->getFile (), getLineNumber (Fields[I].getLoc ()), DL.getTypeSizeInBits (FTy),
+        DL.getABITypeAlign (FTy).value () * 8, SL->getElementOffsetInBits (Elem),
+        llvm::DINode::FlagZero, getType (Fields[I].getType ())));
+    }
+    Builder.replaceArrays (RecordTy, Builder.getOrCreateArray (Members));
+    return RecordTy;
 }
 
 llvm::DIType* CGDebugInfo::getType (TypeDecl* Type) {
     if (llvm::DIType* T = TypeCache[Type])
         return T;
 
-    if (llvm::isa<PervasiveTypeDecl> (Type))
-        return TypeCache[Type] = getType (Type);
+    if (auto* PervasiveTy = llvm::dyn_cast<PervasiveTypeDecl> (Type))
+        return TypeCache[Type] = getType (PervasiveTy);
     if (auto* AliasTy = llvm::dyn_cast<AliasTypeDecl> (Type))
         return TypeCache[Type] = getType (AliasTy);
     if (auto* ArrayTy = llvm::dyn_cast<ArrayTypeDecl> (Type))
         return TypeCache[Type] = getType (ArrayTy);
-    if (auto* RecordTy = llvm ::dyn_cast<RecordTypeDecl> (Type))
-        return TypeCache[Type] = getType (RecordTy);
-
+    if (auto* RecordTy = llvm::dyn_cast<RecordTypeDecl> (Type))
+        return getType (RecordTy); // Caches itself, before its members
 
     llvm::report_fatal_error ("Unsupported type");
-    return nullptr;
+}
+
+// A VAR parameter is passed as a pointer.
+llvm::DIType* CGDebugInfo::getReferenceType (TypeDecl* Type) {
+    if (llvm::DIType* T = RefTypeCache[Type])
+        return T;
+
+    const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
+    return RefTypeCache[Type] = Builder.createReferenceType (llvm::dwarf::DW_TAG_reference_type,
+           getType (Type), DL.getPointerSizeInBits (), DL.getPointerABIAlignment (0).value () * 8);
+}
+
+// An open array is described by its address, which points to the first
+// element. The length is not described.
+llvm::DIType* CGDebugInfo::getParamType (FormalParameterDecl* FP) {
+    if (auto* Open = llvm::dyn_cast<OpenArrayTypeDecl> (FP->getType ()))
+        return getReferenceType (Open->getType ());
+    return FP->isVar () ? getReferenceType (FP->getType ()) : getType (FP->getType ());
 }
 
 llvm::DISubroutineType* CGDebugInfo::getType (ProcedureDecl* P) {
+    // Line tables only need a subprogram per function, not its signature.
+    if (LineTablesOnly) {
+        if (!EmptySubroutineTy)
+            EmptySubroutineTy = Builder.createSubroutineType (Builder.getOrCreateTypeArray ({}));
+        return EmptySubroutineTy;
+    }
+
+    if (llvm::DISubroutineType* T = SubroutineCache[P])
+        return T;
+
     llvm::SmallVector<llvm::Metadata*, 4> Types; // capture llvm::DIType's
-    const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
 
     // Return Value
     if (P->getRetType ())
         Types.push_back (getType (P->getRetType ()));
-    else
-        Types.push_back (Builder.createUnspecifiedType ("void"));
+    else {
+        if (!VoidType)
+            VoidType = Builder.createUnspecifiedType ("void");
+        Types.push_back (VoidType);
+    }
 
     // Params
-    for (auto* FP : P->getFormalParams ()) {
-        llvm::DIType* PT = getType (FP->getType ());
-        if (FP->isVar ()) {
-            llvm::Type* PTy = CGM.convertType (FP->getType ());
-            PT = Builder.createReferenceType (llvm::dwarf::DW_TAG_reference_type, PT,
-            DL.getTypeSizeInBits (PTy) * 8, 1 << Log2 (DL.getABITypeAlign (PTy)));
-        }
-        Types.push_back (PT);
-    }
+    for (auto* FP : P->getFormalParams ())
+        Types.push_back (getParamType (FP));
 
-    return Builder.createSubroutineType (Builder.getOrCreateTypeArray (Types));
+    return SubroutineCache[P] =
+           Builder.createSubroutineType (Builder.getOrCreateTypeArray (Types));
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -112,21 +161,31 @@ llvm::DISubroutineType* CGDebugInfo::getType (ProcedureDecl* P) {
 /////////////////////////////////////////////////////////////////////////////
 
 // Global Variables are straightforward as compared to Local Vars (explained below)
-void CGDebugInfo::emit (VariableDecl* Decl, llvm::GlobalVariable* V) {
+// A variable packed into the module's block lives at Offset within V.
+void CGDebugInfo::emit (VariableDecl* Decl, llvm::GlobalVariable* V, uint64_t Offset) {
+    if (LineTablesOnly)
+        return;
+
+    llvm::DIExpression* Expr = Offset ?
+    Builder.createExpression (llvm::ArrayRef<uint64_t>{ llvm::dwarf::DW_OP_plus_uconst, Offset }) :
+    Builder.createExpression ();
+
     // Create Debug Global expression and add the info to the global var
     llvm::DIGlobalVariableExpression* GV = Builder.createGlobalVariableExpression (
-    getScope (), Decl->getName (), V->getName (), CU->getFile (),
-    getLineNumber (Decl->getLocation ()), getType (Decl->getType ()), false);
+    getScope (), Decl->getName (), CGM.mangleName (Decl), CU->getFile (),
+    getLineNumber (Decl->getLocation ()), getType (Decl->getType ()), false, true, Expr);
     V->addDebugInfo (GV);
 }
 
 // Procedure has an emit() and emitEnd()
 void CGDebugInfo::emit (ProcedureDecl* Decl, llvm::Function* Fn) {
     llvm::DISubroutineType* SubT = getType (Decl);
+    llvm::DISubprogram::DISPFlags SPFlags = llvm::DISubprogram::SPFlagDefinition;
+    if (!Decl->isExported ())
+        SPFlags |= llvm::DISubprogram::SPFlagLocalToUnit;
     llvm::DISubprogram* Sub = Builder.createFunction (getScope (), Decl->getName (),
     Fn->getName (), CU->getFile (), getLineNumber (Decl->getLocation ()), SubT,
-    getLineNumber (Decl->getLocation ()), llvm::DINode::FlagPrototyped,
-    llvm::DISubprogram::SPFlagDefinition);
+    getLineNumber (Decl->getLocation ()), llvm::DINode::FlagPrototyped, SPFlags);
 
     // Don't forget to open scope and set the subprogram to be later cleaned in the end()
     openScope (Sub);
@@ -141,14 +200,21 @@ void CGDebugInfo::emitEnd (ProcedureDecl* Decl, llvm::Function* Fn) {
 
 // Local Variables require llvm.dbg.declare + llvm.dbg.define intrinciscs
 llvm::DILocalVariable*
-CGDebugInfo::emit (FormalParameterDecl* FP, size_t Idx, llvm::Value* Val, llvm::BasicBlock* BB) {
+CGDebugInfo::emit (FormalParameterDecl* FP, size_t Idx, llvm::Value* Val, llvm::BasicBlock* BB, bool InMemory) {
+    if (LineTablesOnly)
+        return nullptr;
+
+    llvm::DIType* Ty = getParamType (FP);
     llvm::DILocalVariable* Var =
     Builder.createParameterVariable (getScope (), FP->getName (), Idx,
-    CU->getFile (), getLineNumber (FP->getLocation ()), getType (FP->getType ()));
-
-    // Insert a new llvm.dbg.value intrinsic call
-    Builder.insertDbgValueIntrinsic (
-    Val, Var, Builder.createExpression (), getDebugLoc (FP->getLocation ()), BB);
+    CU->getFile (), getLineNumber (FP->getLocation ()), Ty);
+
+    // A parameter passed in memory is described by its address
+    if (InMemory)
+        Builder.insertDeclare (Val, Var, Builder.createExpression (), getDebugLoc (FP->getLocation ()), BB);
+    else // Insert a new llvm.dbg.value intrinsic call
+        Builder.insertDbgValueIntrinsic (
+        Val, Var, Builder.createExpression (), getDebugLoc (FP->getLocation ()), BB);
     return Var;
 }
 
@@ -157,15 +223,11 @@ void CGDebugInfo::emit (llvm::Value* Val,
 llvm::DILocalVariable* Var,
 llvm::SMLoc Loc,
 llvm::BasicBlock* BB) {
-    llvm::DebugLoc DLoc = getDebugLoc (Loc);
+    if (!Var)
+        return;
 
     // Insert a new llvm.dbg.value intrinsic call
-    auto Instr =
-    Builder
-    .insertDbgValueIntrinsic (Val, Var, Builder.createExpression (), DLoc, BB)
-    .get<llvm::Instruction*> (); // Per recent changes need to cast from the PointerUnion
-
-    Instr->setDebugLoc (DLoc);
+    Builder.insertDbgValueIntrinsic (Val, Var, Builder.createExpression (), getDebugLoc (Loc), BB);
 }
 
 /////////////////////////////////////////////////////////////////////////////
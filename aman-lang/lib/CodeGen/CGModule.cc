@@ -1,21 +1,189 @@
 #include "amanlang/CodeGen/CGModule.h"
 #include "amanlang/AST/AST.h"
+#include "amanlang/AST/ASTVisitor.h"
+#include "amanlang/CodeGen/CGDebugInfo.h"
 #include "amanlang/CodeGen/CGProcedure.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FormatVariadic.h"
+#include <algorithm>
+#include <numeric>
 
 namespace amanlang {
 
 static llvm::cl::opt<bool>
 Debug ("g", llvm::cl::desc ("Generate debug information"), llvm::cl::init (false));
 
+static llvm::cl::opt<bool> LineTablesOnly ("gline-tables-only",
+llvm::cl::desc ("Generate line tables only, no types or variables"), llvm::cl::init (false));
+
+static llvm::cl::opt<bool> ReorderRecordFields ("freorder-record-fields",
+llvm::cl::desc ("Lay out record fields by decreasing alignment to minimize padding"),
+llvm::cl::init (false));
+
+static llvm::cl::opt<bool> RecordLayoutRemarks ("Rrecord-layout",
+llvm::cl::desc ("Report the size and padding of each record"), llvm::cl::init (false));
+
+enum GlobalLayout { GL_Separate, GL_Frequency, GL_Size };
+static llvm::cl::opt<GlobalLayout> PackGlobals ("fpack-globals",
+llvm::cl::desc ("Pack the module variables into a single block"),
+llvm::cl::values (clEnumValN (GL_Separate, "none", "One global per variable (default)"),
+clEnumValN (GL_Frequency, "frequency", "Most accessed variables first"),
+clEnumValN (GL_Size, "size", "By decreasing alignment, to minimize padding")),
+llvm::cl::init (GL_Separate));
+
+// The fields of a record in declaration order, or by decreasing alignment.
+// Then every field starts aligned and padding is only left at the end. The
+// sort is stable, so fields of equal alignment keep their order.
+static llvm::SmallVector<unsigned, 8>
+getFieldOrder (const llvm::DataLayout& DL, llvm::ArrayRef<llvm::Type*> Types, bool Reorder) {
+    llvm::SmallVector<unsigned, 8> Order (Types.size ());
+    std::iota (Order.begin (), Order.end (), 0);
+    if (Reorder)
+        std::stable_sort (Order.begin (), Order.end (), [&] (unsigned L, unsigned R) {
+            return DL.getABITypeAlign (Types[L]) > DL.getABITypeAlign (Types[R]);
+        });
+    return Order;
+}
+
+// Bytes of a struct that none of its elements occupies.
+static uint64_t getPadding (const llvm::DataLayout& DL, llvm::StructType* STy) {
+    uint64_t Used = 0;
+    for (llvm::Type* Elem : STy->elements ())
+        Used += DL.getTypeAllocSize (Elem).getFixedValue ();
+    return DL.getTypeAllocSize (STy).getFixedValue () - Used;
+}
+
+// Estimates how often each module variable is accessed, from the number of
+// places it is named in. Each enclosing loop counts eight times.
+class GlobalAccessCounter : public StmtVisitor<GlobalAccessCounter>,
+                            public ExprVisitor<GlobalAccessCounter> {
+    friend class StmtVisitor<GlobalAccessCounter>;
+    friend class ExprVisitor<GlobalAccessCounter>;
+
+    public:
+    void run (ModuleDecl* Mod) {
+        visitDecls (Mod->getDecls ());
+        visit (Mod->getStmts ());
+    }
+    uint64_t getCount (Decl* D) const {
+        return Counts.lookup (D);
+    }
+
+    private:
+    llvm::DenseMap<Decl*, uint64_t> Counts;
+    uint64_t Weight = 1;
+
+    using StmtVisitor<GlobalAccessCounter>::visit;
+    using ExprVisitor<GlobalAccessCounter>::visit;
+
+    void visitDecls (const DeclList& Decls) {
+        for (Decl* D : Decls) {
+            if (auto* Proc = llvm::dyn_cast<ProcedureDecl> (D)) {
+                visitDecls (Proc->getDecls ());
+                visit (Proc->getStmts ());
+            }
+        }
+    }
+    void visitLoop (const StmtList& Stmts) {
+        uint64_t Outer = Weight;
+        Weight         = std::min<uint64_t> (Weight * 8, 1 << 24);
+        visit (Stmts);
+        Weight = Outer;
+    }
+    void visitArgs (const ExprList& Args) {
+        for (Expr* E : Args)
+            visit (E);
+    }
+
+    void visitAssignmentStatement (AssignmentStatement* S) {
+        visit (S->getVar ());
+        visit (S->getExpr ());
+    }
+    void visitProcedureCallStatement (ProcedureCallStatement* S) {
+        visitArgs (S->getParams ());
+    }
+    void visitIfStatement (IfStatement* S) {
+        visit (S->getCond ());
+        visit (S->getIfStmts ());
+        visit (S->getElseStmts ());
+    }
+    void visitCaseStatement (CaseStatement* S) {
+        visit (S->getSelector ());
+        for (const CaseAlternative& Alt : S->getCases ())
+            visit (Alt.Stmts);
+        visit (S->getElseStmts ());
+    }
+    void visitWhileStatement (WhileStatement* S) {
+        visit (S->getCond ());
+        visitLoop (S->getStmts ());
+    }
+    void visitForStatement (ForStatement* S) {
+        Counts[S->getVar ()] += Weight;
+        visit (S->getStart ());
+        visit (S->getEnd ());
+        visitLoop (S->getStmts ());
+    }
+    void visitReturnStatement (ReturnStatement* S) {
+        if (S->getExpr ())
+            visit (S->getExpr ());
+    }
+    void visitNewStatement (NewStatement* S) {
+        visit (S->getPtr ());
+    }
+    void visitDisposeStatement (DisposeStatement* S) {
+        visit (S->getPtr ());
+    }
+    void visitTryStatement (TryStatement* S) {
+        visit (S->getStmts ());
+        for (const ExceptHandler& H : S->getHandlers ())
+            visit (H.Stmts);
+        visit (S->getElseStmts ());
+    }
+
+    void visitInfixExpression (InfixExpression* E) {
+        visit (E->getLeft ());
+        visit (E->getRight ());
+    }
+    void visitPrefixExpression (PrefixExpression* E) {
+        visit (E->getExpr ());
+    }
+    void visitDesignator (Designator* E) {
+        Counts[E->getDecl ()] += Weight;
+        for (Selector* Sel : E->getSelectors ())
+            if (auto* Idx = llvm::dyn_cast<IndexSelector> (Sel))
+                visit (Idx->getIndex ());
+    }
+    void visitFunctionCallExpr (FunctionCallExpr* E) {
+        visitArgs (E->getParams ());
+    }
+    void visitConversionExpr (ConversionExpr* E) {
+        visit (E->getExpr ());
+    }
+};
+
+CGModule::CGModule (llvm::Module* M, ASTContext& ASTCtx)
+: M (M), ASTCtx (ASTCtx), Tbaa (*this), Eh (*this), ABI (*this) {
+    initialize ();
+
+    // -g wins over -gline-tables-only, as in clang.
+    if (Debug)
+        DebugInfo = std::make_unique<CGDebugInfo> (*this, llvm::DICompileUnit::FullDebug);
+    else if (LineTablesOnly)
+        DebugInfo = std::make_unique<CGDebugInfo> (*this, llvm::DICompileUnit::LineTablesOnly);
+}
+
+CGModule::~CGModule () = default;
+
 void CGModule::initialize () {
     VoidTy    = llvm::Type::getVoidTy (getLLVMCtx ());
     Int1Ty    = llvm::Type::getInt1Ty (getLLVMCtx ());
     Int32Ty   = llvm::Type::getInt32Ty (getLLVMCtx ());
     Int64Ty   = llvm::Type::getInt64Ty (getLLVMCtx ());
+    PtrTy     = llvm::PointerType::getUnqual (getLLVMCtx ());
     Int32Zero = llvm::ConstantInt::get (Int32Ty, 0, true);
 }
 
@@ -24,12 +192,19 @@ llvm::Type* CGModule::convertType (TypeDecl* Ty) {
     if (auto* T = TypeCache[Ty])
         return T;
 
-    // built-in type
-    if (llvm::isa<PervasiveTypeDecl> (Ty)) {
-        if (Ty->getName () == "INTEGER")
-            return Int64Ty;
-        if (Ty->getName () == "BOOLEAN")
-            return Int1Ty;
+    // built-in type, INT8 => i8 up to INTEGER => i64, BOOLEAN => i1, REAL =>
+    // float and LONGREAL => double
+    if (auto* Pervasive = llvm::dyn_cast<PervasiveTypeDecl> (Ty)) {
+        llvm::Type* T = llvm::Type::getIntNTy (getLLVMCtx (), Pervasive->getBitWidth ());
+        if (Pervasive->isReal ())
+            T = Pervasive->getBitWidth () == 32 ? llvm::Type::getFloatTy (getLLVMCtx ()) :
+                                                  llvm::Type::getDoubleTy (getLLVMCtx ());
+        return TypeCache[Ty] = T;
+    }
+
+    // Pointers are opaque, so a record may point to its own type.
+    else if (llvm::isa<PointerTypeDecl> (Ty)) {
+        return TypeCache[Ty] = PtrTy;
     }
 
     // is an alias
@@ -50,11 +225,22 @@ llvm::Type* CGModule::convertType (TypeDecl* Ty) {
         }
     }
 
-    // Record (different type for each field)
+    // Record (different type for each field). The struct elements may be in
+    // another order than the fields, see getFieldIndex.
     else if (auto* RecordTy = llvm ::dyn_cast<RecordTypeDecl> (Ty)) {
-        llvm::SmallVector<llvm::Type*, 4> Elements;
+        llvm::SmallVector<llvm::Type*, 8> FieldTypes;
         for (const auto& F : RecordTy->getFields ()) {
-            Elements.push_back (convertType (F.getType ())); // recursively get type of field
+            FieldTypes.push_back (convertType (F.getType ())); // recursively get type of field
+        }
+
+        llvm::SmallVector<unsigned, 8> Order =
+        getFieldOrder (M->getDataLayout (), FieldTypes, ReorderRecordFields);
+        llvm::SmallVector<llvm::Type*, 8> Elements;
+        llvm::SmallVector<unsigned, 8>& Indices = FieldIndices[RecordTy];
+        Indices.resize (Order.size ());
+        for (unsigned I = 0, E = Order.size (); I != E; ++I) {
+            Elements.push_back (FieldTypes[Order[I]]);
+            Indices[Order[I]] = I;
         }
         llvm::Type* T = llvm::StructType::create (Elements, RecordTy->getName (), false);
         return TypeCache[Ty] = T;
@@ -63,6 +249,49 @@ llvm::Type* CGModule::convertType (TypeDecl* Ty) {
     llvm::report_fatal_error ("Unsupported type");
 }
 
+unsigned CGModule::getFieldIndex (RecordTypeDecl* Ty, unsigned Index) {
+    convertType (Ty);
+    return FieldIndices[Ty][Index];
+}
+
+/**
+ * Reports the size and padding of each record of the module, including the
+ * records declared in procedures, as remarks at their declarations. The
+ * report also gives the layout of the other field order, so it shows what
+ * -freorder-record-fields saves.
+ *
+ * @param Decls The declarations to search for records.
+ */
+void CGModule::reportRecordLayouts (const DeclList& Decls) {
+    const llvm::DataLayout& DL = M->getDataLayout ();
+    for (auto* D : Decls) {
+        if (auto* Proc = llvm::dyn_cast<ProcedureDecl> (D)) {
+            reportRecordLayouts (Proc->getDecls ());
+            continue;
+        }
+        auto* RecordTy = llvm::dyn_cast<RecordTypeDecl> (D);
+        if (!RecordTy)
+            continue;
+
+        auto* STy = llvm::cast<llvm::StructType> (convertType (RecordTy));
+        llvm::SmallVector<llvm::Type*, 8> FieldTypes;
+        for (unsigned I = 0, E = RecordTy->getFields ().size (); I != E; ++I)
+            FieldTypes.push_back (STy->getElementType (getFieldIndex (RecordTy, I)));
+
+        llvm::SmallVector<llvm::Type*, 8> OtherElements;
+        for (unsigned I : getFieldOrder (DL, FieldTypes, !ReorderRecordFields))
+            OtherElements.push_back (FieldTypes[I]);
+        auto* OtherTy = llvm::StructType::get (getLLVMCtx (), OtherElements);
+
+        std::string Msg = llvm::formatv ("record {0} takes {1} bytes with {2} bytes of padding; "
+                                         "{3} it takes {4} bytes with {5} bytes of padding",
+        RecordTy->getName (), DL.getTypeAllocSize (STy).getFixedValue (), getPadding (DL, STy),
+        ReorderRecordFields ? "in declaration order" : "with -freorder-record-fields",
+        DL.getTypeAllocSize (OtherTy).getFixedValue (), getPadding (DL, OtherTy));
+        ASTCtx.getSourceMgr ().PrintMessage (RecordTy->getLocation (), llvm::SourceMgr::DK_Remark, Msg);
+    }
+}
+
 std::string CGModule::mangleName (Decl* D) {
     std::string Mangled ("_t");
     llvm::SmallString<16> Tmp;
@@ -79,28 +308,217 @@ std::string CGModule::mangleName (Decl* D) {
     return "_t" + Mangled;
 }
 
-void CGModule::decorateInst (llvm::Instruction* Inst, TypeDecl* Type) {
-    if (auto* Tag = this->Tbaa.getAccessTagInfo (Type))
+void CGModule::decorateInst (llvm::Instruction* Inst, TypeDecl* Type, TypeDecl* Base, uint64_t Offset) {
+    if (auto* Tag = this->Tbaa.getAccessTagInfo (Type, Base, Offset))
         Inst->setMetadata (llvm::LLVMContext::MD_tbaa, Tag);
 }
 
+void CGModule::addAliasScope (llvm::Instruction* Inst, AliasScopeKind Kind) {
+    // The named domain and scopes are uniqued, not distinct, nodes. Each
+    // partial module of -irgen-threads creates its own, and the linker merges
+    // them into a single domain.
+    if (!AliasScopes[Kind]) {
+        llvm::MDBuilder MDB (getLLVMCtx ());
+        llvm::MDNode* Domain      = MDB.createAliasScopeDomain ("Aman");
+        AliasScopes[AS_VarParams] = MDB.createAliasScope ("VAR parameters", Domain);
+        AliasScopes[AS_Globals]   = MDB.createAliasScope ("module variables", Domain);
+    }
+
+    AliasScopeKind Other = Kind == AS_VarParams ? AS_Globals : AS_VarParams;
+    Inst->setMetadata (llvm::LLVMContext::MD_alias_scope, llvm::MDNode::get (getLLVMCtx (), AliasScopes[Kind]));
+    Inst->setMetadata (llvm::LLVMContext::MD_noalias, llvm::MDNode::get (getLLVMCtx (), AliasScopes[Other]));
+}
+
+llvm::FunctionCallee CGModule::getCheckFailedFn () {
+    if (llvm::Function* Fn = M->getFunction ("__aman_check_failed"))
+        return Fn;
+
+    auto* FTy = llvm::FunctionType::get (VoidTy, { Int32Ty }, false);
+    auto* Fn  = llvm::Function::Create (FTy, llvm::GlobalValue::ExternalLinkage, "__aman_check_failed", M);
+    Fn->setDoesNotReturn ();
+    Fn->setDoesNotThrow ();
+    Fn->addFnAttr (llvm::Attribute::Cold);
+    Fn->setMemoryEffects (llvm::MemoryEffects::inaccessibleMemOnly ());
+    return Fn;
+}
+
+// The attributes tell LLVM that these are an allocator and its deallocator,
+// so an object that doesn't escape can be promoted to the stack or removed.
+llvm::FunctionCallee CGModule::getNewFn () {
+    if (llvm::Function* Fn = M->getFunction ("__aman_new"))
+        return Fn;
+
+    llvm::LLVMContext& Ctx = getLLVMCtx ();
+    auto* FTy              = llvm::FunctionType::get (PtrTy, { Int64Ty }, false);
+    auto* Fn = llvm::Function::Create (FTy, llvm::GlobalValue::ExternalLinkage, "__aman_new", M);
+    Fn->setDoesNotThrow ();
+    Fn->setMemoryEffects (llvm::MemoryEffects::inaccessibleMemOnly ());
+    Fn->addFnAttr (llvm::Attribute::getWithAllocSizeArgs (Ctx, 0, std::nullopt));
+    Fn->addFnAttr (llvm::Attribute::get (Ctx, llvm::Attribute::AllocKind,
+    static_cast<uint64_t> (llvm::AllocFnKind::Alloc | llvm::AllocFnKind::Uninitialized)));
+    Fn->addFnAttr ("alloc-family", "aman");
+    Fn->addRetAttr (llvm::Attribute::NoAlias);
+    Fn->addRetAttr (llvm::Attribute::NonNull);
+    Fn->addRetAttr (llvm::Attribute::getWithAlignment (Ctx, llvm::Align (16)));
+    return Fn;
+}
+
+llvm::FunctionCallee CGModule::getDisposeFn () {
+    if (llvm::Function* Fn = M->getFunction ("__aman_dispose"))
+        return Fn;
+
+    llvm::LLVMContext& Ctx = getLLVMCtx ();
+    auto* FTy              = llvm::FunctionType::get (VoidTy, { PtrTy, Int64Ty }, false);
+    auto* Fn = llvm::Function::Create (FTy, llvm::GlobalValue::ExternalLinkage, "__aman_dispose", M);
+    Fn->setDoesNotThrow ();
+    Fn->setMemoryEffects (llvm::MemoryEffects::argMemOnly () | llvm::MemoryEffects::inaccessibleMemOnly ());
+    Fn->addFnAttr (llvm::Attribute::get (
+    Ctx, llvm::Attribute::AllocKind, static_cast<uint64_t> (llvm::AllocFnKind::Free)));
+    Fn->addFnAttr ("alloc-family", "aman");
+    Fn->addParamAttr (0, llvm::Attribute::AllocatedPointer);
+    Fn->addParamAttr (0, llvm::Attribute::NoCapture);
+    return Fn;
+}
+
 void CGModule::run (ModuleDecl* Mod) {
+    emitGlobals (Mod);
+
+    for (auto* Decl : Mod->getDecls ())
+        if (auto* Procedure = llvm::dyn_cast<ProcedureDecl> (Decl))
+            emitProcedure (Procedure);
+
+    if (DebugInfo)
+        DebugInfo->finalize ();
+}
+
+void CGModule::emitGlobals (ModuleDecl* Mod, bool Definitions) {
     this->ModDecl = Mod;
 
+    // The structured constants are defined here, so the partial modules of
+    // -irgen-threads share them. Those get a copy of the initializer to fold
+    // loads with, which the linker drops.
+    llvm::SmallVector<VariableDecl*, 16> Vars;
     for (auto* Decl : Mod->getDecls ()) {
-        if (auto* Var = llvm::dyn_cast<VariableDecl> (Decl)) {
-            auto Global = new llvm::GlobalVariable (*M, convertType (Var->getType ()),
-            false, llvm::GlobalValue::PrivateLinkage, nullptr, mangleName (Var));
-            Globals[Var] = Global;
-            return;
+        if (auto* Var = llvm::dyn_cast<VariableDecl> (Decl))
+            Vars.push_back (Var);
+        else if (auto* C = llvm::dyn_cast<ConstantDecl> (Decl);
+                 C && llvm::isa_and_nonnull<AggregateLiteral> (C->getExpr ())) {
+            llvm::GlobalVariable* G = getConstant (C);
+            if (!Definitions)
+                G->setLinkage (llvm::GlobalValue::AvailableExternallyLinkage);
         }
+    }
 
-        if (auto* Procedure = llvm::dyn_cast<ProcedureDecl> (Decl)) {
-            CGProcedure CGP (*this);
-            CGP.run (Procedure);
-            return;
+    if (PackGlobals != GL_Separate && !Vars.empty ())
+        emitGlobalBlock (Mod, Vars, Definitions);
+    else {
+        for (VariableDecl* Var : Vars) {
+            llvm::Type* Ty = convertType (Var->getType ());
+            auto Global    = Definitions ?
+            new llvm::GlobalVariable (*M, Ty, false, llvm::GlobalValue::PrivateLinkage,
+            llvm::Constant::getNullValue (Ty), mangleName (Var)) :
+            new llvm::GlobalVariable (*M, Ty, false, llvm::GlobalValue::ExternalLinkage,
+            nullptr, mangleName (Var));
+            Globals[Var] = Global;
+            if (DebugInfo && Definitions)
+                DebugInfo->emit (Var, Global);
         }
     }
+
+    if (RecordLayoutRemarks && Definitions)
+        reportRecordLayouts (Mod->getDecls ());
+}
+
+// Structured constants go to read-only data. Their address can't be told
+// apart, so identical tables may be merged.
+llvm::GlobalVariable* CGModule::getConstant (ConstantDecl* C) {
+    llvm::GlobalVariable*& G = Constants[C];
+    if (!G) {
+        llvm::Constant* Init = emitConstant (C->getExpr ());
+        G = new llvm::GlobalVariable (*M, Init->getType (), true, llvm::GlobalValue::PrivateLinkage,
+        Init, mangleName (C));
+        G->setUnnamedAddr (llvm::GlobalValue::UnnamedAddr::Global);
+    }
+    return G;
+}
+
+// Sema has folded the scalars of a structured constant into literals. The
+// fields of a record may be laid out in another order, see getFieldIndex.
+llvm::Constant* CGModule::emitConstant (Expr* E) {
+    if (auto* Lit = llvm::dyn_cast<IntegerLiteral> (E))
+        return llvm::ConstantInt::get (convertType (E->getType ()), Lit->getValue ());
+    if (auto* Lit = llvm::dyn_cast<RealLiteral> (E))
+        return llvm::ConstantFP::get (getLLVMCtx (), Lit->getValue ());
+    if (auto* Lit = llvm::dyn_cast<BooleanLiteral> (E))
+        return llvm::ConstantInt::get (Int1Ty, Lit->getValue ());
+
+    auto* Agg = llvm::cast<AggregateLiteral> (E);
+    llvm::SmallVector<llvm::Constant*, 16> Elements;
+    for (Expr* Elem : Agg->getElements ())
+        Elements.push_back (emitConstant (Elem));
+
+    llvm::Type* Ty = convertType (Agg->getType ());
+    if (auto* ArrTy = llvm::dyn_cast<llvm::ArrayType> (Ty))
+        return llvm::ConstantArray::get (ArrTy, Elements);
+
+    auto* RecordTy = llvm::cast<RecordTypeDecl> (Agg->getType ());
+    llvm::SmallVector<llvm::Constant*, 16> Fields (Elements.size ());
+    for (unsigned I = 0, N = Elements.size (); I != N; ++I)
+        Fields[getFieldIndex (RecordTy, I)] = Elements[I];
+    return llvm::ConstantStruct::get (llvm::cast<llvm::StructType> (Ty), Fields);
+}
+
+/**
+ * Packs the module variables into one zero-initialized struct, so variables
+ * used together share cache lines and each one is a constant offset from a
+ * single base. The block starts on a cache line. The order depends on nothing
+ * but the module, so the partial modules of -irgen-threads agree on it.
+ *
+ * In the debug info, each variable is described as an offset into the block.
+ *
+ * @param Mod The module.
+ * @param Vars The module variables in declaration order.
+ * @param Definitions Whether the block is defined or only declared.
+ */
+void CGModule::emitGlobalBlock (ModuleDecl* Mod, llvm::ArrayRef<VariableDecl*> Vars, bool Definitions) {
+    const llvm::DataLayout& DL = M->getDataLayout ();
+    llvm::SmallVector<llvm::Type*, 16> Types;
+    for (VariableDecl* Var : Vars)
+        Types.push_back (convertType (Var->getType ()));
+
+    llvm::SmallVector<unsigned, 8> Order = getFieldOrder (DL, Types, PackGlobals == GL_Size);
+    if (PackGlobals == GL_Frequency) {
+        GlobalAccessCounter Counter;
+        Counter.run (Mod);
+        std::stable_sort (Order.begin (), Order.end (), [&] (unsigned L, unsigned R) {
+            return Counter.getCount (Vars[L]) > Counter.getCount (Vars[R]);
+        });
+    }
+
+    llvm::SmallVector<llvm::Type*, 16> Elements;
+    for (unsigned I : Order)
+        Elements.push_back (Types[I]);
+    auto* BlockTy    = llvm::StructType::create (Elements, (Mod->getName () + ".vars").str ());
+    std::string Name = mangleName (Mod) + ".vars";
+    auto* Block      = Definitions ?
+    new llvm::GlobalVariable (*M, BlockTy, false, llvm::GlobalValue::PrivateLinkage,
+    llvm::Constant::getNullValue (BlockTy), Name) :
+    new llvm::GlobalVariable (*M, BlockTy, false, llvm::GlobalValue::ExternalLinkage, nullptr, Name);
+    Block->setAlignment (std::max (DL.getABITypeAlign (BlockTy), llvm::Align (64)));
+
+    const llvm::StructLayout* Layout = DL.getStructLayout (BlockTy);
+    for (unsigned I = 0, E = Order.size (); I != E; ++I) {
+        VariableDecl* Var     = Vars[Order[I]];
+        llvm::Constant* Idx[] = { Int32Zero, llvm::ConstantInt::get (Int32Ty, I) };
+        Globals[Var]          = llvm::ConstantExpr::getInBoundsGetElementPtr (BlockTy, Block, Idx);
+        if (DebugInfo && Definitions)
+            DebugInfo->emit (Var, Block, Layout->getElementOffset (I));
+    }
+}
+
+void CGModule::emitProcedure (ProcedureDecl* Proc) {
+    CGProcedure CGP (*this);
+    CGP.run (Proc);
 }
 
 } // namespace amanlang
\ No newline at end of file
@@ -1,230 +1,546 @@
 #include "amanlang/CodeGen/CGProcedure.h"
 #include "amanlang/AST/AST.h"
+#include "amanlang/CodeGen/CGDebugInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/Support/CommandLine.h"
+#include <algorithm>
+#include <limits>
 
 namespace amanlang {
 
+static llvm::cl::opt<bool> BoundsCheck ("fbounds-check",
+llvm::cl::desc ("Check array indices against the array length at runtime"),
+llvm::cl::init (false));
+
+static llvm::cl::opt<bool> DivCheck ("fdiv-check",
+llvm::cl::desc ("Check divisors of DIV and MOD against zero at runtime"),
+llvm::cl::init (false));
+
+static llvm::cl::opt<bool> FastMath ("ffast-math",
+llvm::cl::desc ("Allow reassociation and other algebra on reals that is not IEEE 754 exact"),
+llvm::cl::init (false));
+
+enum FPContractKind { FPC_Off, FPC_On, FPC_Fast };
+static llvm::cl::opt<FPContractKind> FPContract ("ffp-contract",
+llvm::cl::desc ("Fuse multiplications and additions of reals"),
+llvm::cl::values (clEnumValN (FPC_Off, "off", "Never fuse"),
+clEnumValN (FPC_On, "on", "Fuse `a * b + c` within an expression (default)"),
+clEnumValN (FPC_Fast, "fast", "Fuse wherever the optimizer finds a multiplication and an addition")),
+llvm::cl::init (FPC_On));
+
+static llvm::cl::opt<unsigned> LoopVectorizeWidth ("floop-vectorize-width",
+llvm::cl::desc ("Ask the loop vectorizer to vectorize FOR loops with this width (0 = no hint)"),
+llvm::cl::init (0));
+
+static llvm::cl::opt<unsigned> LoopUnrollCount ("floop-unroll-count",
+llvm::cl::desc ("Ask the loop unroller to unroll FOR loops this many times (0 = no hint)"),
+llvm::cl::init (0));
+
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - CGProcedure (Init)
 /////////////////////////////////////////////////////////////////////////////
 
 void CGProcedure::run (ProcedureDecl* Proc) {
-    FunType  = createFunctionType (Proc);
+    ProcDecl = Proc;
+    FnInfo   = &CGM.getABIInfo ().getFunctionInfo (Proc);
+    FunType  = FnInfo->FnTy;
     Function = createFunction (Proc, FunType);
-
-    // create first BB
+    // A call emitted earlier left an external declaration.
+    if (!Proc->isExported ())
+        Function->setLinkage (llvm::GlobalValue::InternalLinkage);
+
+    CGDebugInfo* DI = CGM.getDbgInfo ();
+    if (DI)
+        DI->emit (Proc, Function);
+
+    // Number the variables in SSA form before the first block is created.
+    for (FormalParameterDecl* FP : Proc->getFormalParams ())
+        if (!FP->isVar () && !FP->isOpenArray ())
+            addSlot (FP, mapType (FP));
+    for (auto* D : Proc->getDecls ())
+        if (auto* Var = llvm::dyn_cast<VariableDecl> (D))
+            addSlot (Var, mapType (Var));
+
+    // create first BB, it has no predecessors
     llvm::BasicBlock* BB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "entry", Function);
     setInsertion (BB);
+    sealBlock (BB);
+
+    // Every operation on reals the Builder creates carries these flags. The
+    // vectorizer needs reassociation to split a reduction into lanes.
+    llvm::FastMathFlags FMF;
+    if (FastMath)
+        FMF.setFast ();
+    if (FPContract == FPC_Fast)
+        FMF.setAllowContract ();
+    Builder.setFastMathFlags (FMF);
 
     // We must step through all formal parameters. To handle VAR parameters correctly
     // In contrast to local variables,
     // formal parameters have a value in the first basic block, so we must make these values known
-    for (auto [Idx, Arg] : llvm::enumerate (Function->args ())) {
-        FormalParameterDecl* FP = Proc->getFormalParams ()[Idx];
-        FormalParams[FP]        = &Arg;
-        writeLocalVariable (CurrBlk, FP, &Arg);
+    // An sret result and open arrays take extra arguments.
+    llvm::Argument* Arg = Function->arg_begin ();
+    if (FnInfo->Ret.isIndirect ())
+        SRetArg = Arg++;
+    for (auto [Idx, FP] : llvm::enumerate (Proc->getFormalParams ())) {
+        const ABIArgInfo& AI = FnInfo->Params[Idx];
+        FormalParams[FP]     = Arg;
+        if (FP->isOpenArray ())
+            OpenArrayLengths[FP] = ++Arg;
+        else if (AI.isIndirect ())
+            Addresses[FP] = Arg; // The byval copy belongs to the procedure
+        else if (AI.isCoerce ()) {
+            auto* Slot = Builder.CreateAlloca (AI.getType (), nullptr, FP->getName ());
+            storeCoerced (Arg, Slot, AI);
+            Addresses[FP] = Slot;
+        } else if (!FP->isVar () && (Arg->getType ()->isAggregateType () || FP->isAddressTaken ())) {
+            // So is a parameter that a call inside TRY may write before it
+            // raises: the handler must see the value it wrote.
+            auto* Slot = Builder.CreateAlloca (Arg->getType (), nullptr, FP->getName ());
+            Builder.CreateStore (Arg, Slot);
+            Addresses[FP] = Slot;
+        } else if (!FP->isVar ())
+            writeLocalVariable (CurrBlk, getSlot (FP), Arg);
+
+        if (DI && (AI.isIndirect () || AI.isCoerce () || FP->isAddressTaken ()))
+            DI->emit (FP, Idx + 1, Addresses[FP], BB, /*InMemory=*/true);
+        else if (DI)
+            DI->emit (FP, Idx + 1, FormalParams[FP], BB);
+        ++Arg;
     }
 
-    auto Block = Proc->getStmts ();
-    this->operator() (Block); // call emit on statements
+    // Arrays and records live in memory, so selectors have an address to work
+    // on; so do variables passed as VAR arguments.
+    for (auto* D : Proc->getDecls ()) {
+        if (auto* Var = llvm::dyn_cast<VariableDecl> (D)) {
+            llvm::Type* Ty = CGM.convertType (Var->getType ());
+            if (Ty->isAggregateType () || Var->isAddressTaken ())
+                Addresses[Var] = Builder.CreateAlloca (Ty, nullptr, Var->getName ());
+        }
+    }
+
+    visit (Proc->getStmts ()); // call emit on statements
 
-    // The last block after generating the IR code may not be sealed yet, so we must call sealBlock()
     if (!CurrBlk->getTerminator ()) {
-        Builder.CreateRetVoid (); // we may have an implicit return
+        if (Proc->getRetType ())
+            Builder.CreateUnreachable (); // fell off the end of a function procedure
+        else
+            Builder.CreateRetVoid (); // we may have an implicit return
     }
-    sealBlock (CurrBlk);
+
+    eliminateBoundsChecks ();
+
+    if (DI)
+        DI->emitEnd (Proc, Function);
 }
 
 void CGProcedure::run() {}
 
+llvm::Value* CGProcedure::visit (Stmt* S) {
+    CurLoc = S->getLocation ();
+    if (CGDebugInfo* DI = CGM.getDbgInfo ())
+        Builder.SetCurrentDebugLocation (DI->getDebugLoc (S->getLocation ()));
+    return StmtVisitor::visit (S);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - CGProcedure (Emit - Expr)
 /////////////////////////////////////////////////////////////////////////////
 
-llvm::Value* CGProcedure::operator() (InfixExpression* E) {
-    llvm::Value* Left   = this->operator() (E->getLeft ());
-    llvm::Value* Right  = this->operator() (E->getRight ());
+llvm::Value* CGProcedure::visitInfixExpression (InfixExpression* E) {
+    tok::TokenKind Op = E->getOperatorInfo ().getKind ();
+    if (Op == tok::kw_AND || Op == tok::kw_OR)
+        return emitShortCircuit (E, Op == tok::kw_AND);
+
+    if (getRealType (E->getLeft ()->getType ()))
+        return emitRealInfix (E);
+
+    llvm::Value* Left   = visit (E->getLeft ());
+    llvm::Value* Right  = visit (E->getRight ());
     llvm::Value* Result = nullptr;
 
+    // Overflow is an error for the signed types and CARDINAL alike, so the
+    // arithmetic is nsw or nuw. Sema converted both operands to one type.
+    PervasiveTypeDecl* IntTy = getIntegerType (E->getLeft ()->getType ());
+    bool IsSigned            = !IntTy || IntTy->isSigned ();
+    using Pred               = llvm::CmpInst::Predicate;
+
     // Creates operator from UserOperator
     // And inserts it into IRBuilder
     switch (E->getOperatorInfo ().getKind ()) {
-    case tok::plus: Result = Builder.CreateNSWAdd (Left, Right); break;
-    case tok::minus: Result = Builder.CreateNSWSub (Left, Right); break;
-    case tok::star: Result = Builder.CreateNSWMul (Left, Right); break;
-    case tok::kw_DIV: Result = Builder.CreateSDiv (Left, Right); break;
-    case tok::kw_MOD: Result = Builder.CreateSRem (Left, Right); break;
+    case tok::plus: Result = Builder.CreateAdd (Left, Right, "", !IsSigned, IsSigned); break;
+    case tok::minus: Result = Builder.CreateSub (Left, Right, "", !IsSigned, IsSigned); break;
+    case tok::star: Result = Builder.CreateMul (Left, Right, "", !IsSigned, IsSigned); break;
+    case tok::kw_DIV:
+        emitDivCheck (Right);
+        Result = IsSigned ? Builder.CreateSDiv (Left, Right) : Builder.CreateUDiv (Left, Right);
+        break;
+    case tok::kw_MOD:
+        emitDivCheck (Right);
+        Result = IsSigned ? Builder.CreateSRem (Left, Right) : Builder.CreateURem (Left, Right);
+        break;
     case tok::equal: Result = Builder.CreateICmpEQ (Left, Right); break;
     case tok::hash: Result = Builder.CreateICmpNE (Left, Right); break;
-    case tok::less: Result = Builder.CreateICmpSLT (Left, Right); break;
-    case tok::lessequal: Result = Builder.CreateICmpSLE (Left, Right); break;
-    case tok::greater: Result = Builder.CreateICmpSGT (Left, Right); break;
-    case tok::greaterequal: Result = Builder.CreateICmpSGE (Left, Right); break;
-    case tok::kw_AND: Result = Builder.CreateAnd (Left, Right); break;
-    case tok::kw_OR: Result = Builder.CreateOr (Left, Right); break;
-    case tok::slash:
-        // Divide by real numbers not supported.
-        [[fallthrough]];
+    case tok::less:
+        Result = Builder.CreateICmp (IsSigned ? Pred::ICMP_SLT : Pred::ICMP_ULT, Left, Right);
+        break;
+    case tok::lessequal:
+        Result = Builder.CreateICmp (IsSigned ? Pred::ICMP_SLE : Pred::ICMP_ULE, Left, Right);
+        break;
+    case tok::greater:
+        Result = Builder.CreateICmp (IsSigned ? Pred::ICMP_SGT : Pred::ICMP_UGT, Left, Right);
+        break;
+    case tok::greaterequal:
+        Result = Builder.CreateICmp (IsSigned ? Pred::ICMP_SGE : Pred::ICMP_UGE, Left, Right);
+        break;
+    default: llvm_unreachable ("Wrong operator");
+    }
+    return Result;
+}
+
+// Operations on reals follow IEEE 754, as far as the fast-math flags of the
+// Builder allow, see run(). The comparisons are ordered, false if an operand
+// is a NaN, except `#`, which is then true.
+llvm::Value* CGProcedure::emitRealInfix (InfixExpression* E) {
+    tok::TokenKind Op = E->getOperatorInfo ().getKind ();
+    if ((Op == tok::plus || Op == tok::minus) && FPContract == FPC_On &&
+    !Builder.getFastMathFlags ().allowContract ())
+        if (llvm::Value* Result = emitFMulAdd (E, Op == tok::minus))
+            return Result;
+
+    llvm::Value* Left  = visit (E->getLeft ());
+    llvm::Value* Right = visit (E->getRight ());
+    switch (Op) {
+    case tok::plus: return Builder.CreateFAdd (Left, Right);
+    case tok::minus: return Builder.CreateFSub (Left, Right);
+    case tok::star: return Builder.CreateFMul (Left, Right);
+    case tok::slash: return Builder.CreateFDiv (Left, Right);
+    case tok::equal: return Builder.CreateFCmpOEQ (Left, Right);
+    case tok::hash: return Builder.CreateFCmpUNE (Left, Right);
+    case tok::less: return Builder.CreateFCmpOLT (Left, Right);
+    case tok::lessequal: return Builder.CreateFCmpOLE (Left, Right);
+    case tok::greater: return Builder.CreateFCmpOGT (Left, Right);
+    case tok::greaterequal: return Builder.CreateFCmpOGE (Left, Right);
     default: llvm_unreachable ("Wrong operator");
     }
 }
 
-llvm::Value* CGProcedure::operator() (PrefixExpression* E) {
-    llvm::Value* Result = this->operator() (E->getExpr ());
+// With -ffp-contract=on, a multiplication that is an operand of an addition
+// or subtraction in the same expression becomes llvm.fmuladd, which the
+// backend emits as a single FMA where the target has one:
+//
+//   a * b + c  =>  fmuladd (a, b, c)      c - a * b  =>  fmuladd (-a, b, c)
+//
+// Returns nullptr if neither operand is a multiplication.
+llvm::Value* CGProcedure::emitFMulAdd (InfixExpression* E, bool IsSub) {
+    auto AsMul = [] (Expr* Operand) {
+        auto* Mul = llvm::dyn_cast<InfixExpression> (Operand);
+        return Mul && Mul->getOperatorInfo ().getKind () == tok::star ? Mul : nullptr;
+    };
+    InfixExpression* Mul = AsMul (E->getLeft ());
+    bool MulIsLeft       = Mul != nullptr;
+    if (!Mul && !(Mul = AsMul (E->getRight ())))
+        return nullptr;
+
+    // The operands are evaluated from left to right, as without fusion.
+    llvm::Value *A, *B, *C;
+    if (MulIsLeft) {
+        A = visit (Mul->getLeft ());
+        B = visit (Mul->getRight ());
+        C = visit (E->getRight ());
+        if (IsSub)
+            C = Builder.CreateFNeg (C);
+    } else {
+        C = visit (E->getLeft ());
+        A = visit (Mul->getLeft ());
+        B = visit (Mul->getRight ());
+        if (IsSub)
+            A = Builder.CreateFNeg (A);
+    }
+    return Builder.CreateIntrinsic (llvm::Intrinsic::fmuladd, { A->getType () }, { A, B, C });
+}
+
+// The right operand of AND and OR is only evaluated if the left one doesn't
+// decide the result. A cheap one without side effects is evaluated anyway,
+// into a select, which avoids a branch:
+//
+//   and.rhs:                                 ; Left is true
+//     %r = call i1 @P ()
+//     br label %and.end
+//   and.end:
+//     %0 = phi i1 [ false, %entry ], [ %r, %and.rhs ]
+//
+// The end block is sealed once both predecessors are known, so variables
+// written on the right, e.g. VAR arguments, get their phis there.
+llvm::Value* CGProcedure::emitShortCircuit (InfixExpression* E, bool IsAnd) {
+    llvm::Value* Left = visit (E->getLeft ());
+    if (isCheapOperand (E->getRight ())) {
+        llvm::Value* Right = visit (E->getRight ());
+        return IsAnd ? Builder.CreateLogicalAnd (Left, Right) : Builder.CreateLogicalOr (Left, Right);
+    }
+
+    llvm::BasicBlock* LeftBB  = CurrBlk;
+    llvm::BasicBlock* RightBB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), IsAnd ? "and.rhs" : "or.rhs", Function);
+    llvm::BasicBlock* EndBB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), IsAnd ? "and.end" : "or.end", Function);
+    if (IsAnd)
+        Builder.CreateCondBr (Left, RightBB, EndBB);
+    else
+        Builder.CreateCondBr (Left, EndBB, RightBB);
+
+    setInsertion (RightBB);
+    sealBlock (RightBB);
+    llvm::Value* Right = visit (E->getRight ());
+    llvm::BasicBlock* RightEndBB = CurrBlk; // The right operand may end in another block
+    Builder.CreateBr (EndBB);
+
+    setInsertion (EndBB);
+    sealBlock (EndBB);
+    llvm::PHINode* Phi = Builder.CreatePHI (CGM.Int1Ty, 2);
+    Phi->addIncoming (llvm::ConstantInt::get (CGM.Int1Ty, !IsAnd), LeftBB);
+    Phi->addIncoming (Right, RightEndBB);
+    return Phi;
+}
+
+// An operand is cheap if it is small and evaluating it can neither fail nor
+// have side effects: no calls, no selectors, which may fail a check or follow
+// NIL, and no DIV or MOD.
+bool CGProcedure::isCheapOperand (Expr* E, unsigned Budget) {
+    if (Budget == 0)
+        return false;
+    switch (E->getKind ()) {
+    case Expr::EK_Int:
+    case Expr::EK_Real:
+    case Expr::EK_Bool:
+    case Expr::EK_High: return true;
+    case Expr::EK_Const: return isCheapOperand (llvm::cast<ConstantAccess> (E)->geDecl ()->getExpr (), Budget);
+    case Expr::EK_Designator: return llvm::cast<Designator> (E)->getSelectors ().empty ();
+    case Expr::EK_Conv: return isCheapOperand (llvm::cast<ConversionExpr> (E)->getExpr (), Budget - 1);
+    case Expr::EK_Prefix: return isCheapOperand (llvm::cast<PrefixExpression> (E)->getExpr (), Budget - 1);
+    case Expr::EK_Infix: {
+        auto* Infix       = llvm::cast<InfixExpression> (E);
+        tok::TokenKind Op = Infix->getOperatorInfo ().getKind ();
+        return Op != tok::kw_DIV && Op != tok::kw_MOD &&
+        isCheapOperand (Infix->getLeft (), Budget - 1) && isCheapOperand (Infix->getRight (), Budget / 2);
+    }
+    default: return false;
+    }
+}
+
+llvm::Value* CGProcedure::visitPrefixExpression (PrefixExpression* E) {
+    llvm::Value* Result = visit (E->getExpr ());
     switch (E->getOperatorInfo ().getKind ()) {
     case tok::plus: break;
-    case tok::minus: Result = Builder.CreateNeg (Result); break;
+    case tok::minus:
+        Result = Result->getType ()->isFloatingPointTy () ? Builder.CreateFNeg (Result) :
+                                                            Builder.CreateNSWNeg (Result);
+        break;
     case tok::kw_NOT: Result = Builder.CreateNot (Result); break;
     default: llvm_unreachable ("Wrong operator used for prefix");
     }
     return Result;
 }
 
-llvm::Value* CGProcedure::operator() (Expr* E) {
-    if (auto* Infix = llvm::dyn_cast<InfixExpression> (E)) {
-        return (*this) (Infix);
-    } else if (auto* Prefix = llvm::dyn_cast<PrefixExpression> (E)) {
-        return (*this) (Prefix);
-    } else if (auto* Var = llvm::dyn_cast<Designator> (E)) {
-        return (*this) (Var);
-    } else if (auto* Const = llvm::dyn_cast<ConstantAccess> (E)) {
-        return (*this) (Const);
-    } else if (auto* IntLit = llvm::dyn_cast<IntegerLiteral> (E)) {
-        return (*this) (IntLit);
-    } else if (auto* BoolLit = llvm::dyn_cast<BooleanLiteral> (E)) {
-        return (*this) (BoolLit);
-    } else {
-        llvm_unreachable ("Unknown expression type");
-    }
+llvm::Value* CGProcedure::visitFunctionCallExpr (FunctionCallExpr* E) {
+    return emitCall (E->geDecl (), E->getParams ());
 }
 
-// ch.5
-// Examples with CreateInBoundsGEP function
-
-// Value *i32zero = ConstantInt::get(contexet, APInt(32, 0));
-// Value *indices[2] = {i32zero, i32zero};
-// builder.CreateInBoundsGEP(var, ArrayRef<Value *>(indices, 2));
-
-// Which will yield
-
-// %1 = getelementptr inbounds [10 x i32], [10 x i32]* %0, i32 0, i32 0
-llvm::Value* CGProcedure::_handleDesignator (Designator* Var) {
-    auto* Decl       = Var->getDecl ();
-    llvm::Value* Val = readVariable (CurrBlk, Decl);
-
-    // add array and record support.
-    auto& Selectors = Var->getSelectors ();
-    for (auto it = Selectors.begin (); it != Selectors.end ();) {
-        // Index Selector [3]
-        if (auto* IdxSel = llvm::dyn_cast<IndexSelector> (*it)) {
-            llvm::SmallVector<llvm::Value*, 4> IdxList;
-            while (it != Selectors.end ()) {
-                if (auto* Sel = llvm::dyn_cast<IndexSelector> (*it)) {
-                    IdxList.push_back (this->operator() (Sel->getIndex ()));
-                    ++it;
-                } else
-                    break;
-            }
-            Val = Builder.CreateInBoundsGEP (Val->getType (), Val, IdxList);
-            Val = Builder.CreateLoad (Val->getType (), Val);
-        }
-        // Field Selector .xyz
-        else if (auto* FieldSel = llvm::dyn_cast<FieldSelector> (*it)) {
-            llvm::SmallVector<llvm::Value*, 4> IdxList;
-            while (it != Selectors.end ()) {
-                if (auto* Sel = llvm::dyn_cast<FieldSelector> (*it)) {
-                    llvm::Value* V =
-                    llvm::ConstantInt::get (CGM.Int64Ty, Sel->getIndex ());
-                    IdxList.push_back (V);
-                    ++it;
-                } else
-                    break;
+// Widening follows the signedness of the operand, e.g. `sext i8 to i64`;
+// narrowing truncates. A real converted to an integer is truncated toward
+// zero; a value out of range of the integer type is poison.
+llvm::Value* CGProcedure::visitConversionExpr (ConversionExpr* E) {
+    llvm::Value* Val         = visit (E->getExpr ());
+    llvm::Type* Ty           = CGM.convertType (E->getType ());
+    PervasiveTypeDecl* From  = getIntegerType (E->getExpr ()->getType ());
+    PervasiveTypeDecl* IntTy = getIntegerType (E->getType ());
+    if (From && IntTy)
+        return Builder.CreateIntCast (Val, Ty, From->isSigned ());
+    if (From)
+        return From->isSigned () ? Builder.CreateSIToFP (Val, Ty) : Builder.CreateUIToFP (Val, Ty);
+    if (IntTy)
+        return IntTy->isSigned () ? Builder.CreateFPToSI (Val, Ty) : Builder.CreateFPToUI (Val, Ty);
+    return Builder.CreateFPCast (Val, Ty);
+}
 
+llvm::Value* CGProcedure::visitHighExpr (HighExpr* E) {
+    return Builder.CreateNSWSub (OpenArrayLengths[E->getParam ()], llvm::ConstantInt::get (CGM.Int64Ty, 1));
+}
 
-                Val = Builder.CreateInBoundsGEP (Val->getType (), Val, IdxList);
-                Val = Builder.CreateLoad (Val->getType (), Val);
-            }
-        }
+llvm::Value* CGProcedure::visitDesignator (Designator* Desig) {
+    if (Desig->getSelectors ().empty ())
+        return readVariable (CurrBlk, Desig->getDecl ());
 
-        // Deref *it
-        else if (auto* _ = llvm::dyn_cast<DerefSelector> (*it)) {
-            Val = Builder.CreateLoad (Val->getType (), Val);
-            ++it;
-        }
+    MemAccess Access;
+    llvm::Value* Addr = emitDesignatorAddress (Desig, Access);
+    auto* Load        = Builder.CreateLoad (CGM.convertType (Desig->getType ()), Addr);
+    decorateAccess (Load, Desig->getType (), Access);
+    return Load;
+}
 
-        else {
+// ch.5
+// Computes the address of the component a designator selects. A run of index
+// and field selectors becomes a single GEP from the address the run starts
+// at, e.g. for `a[i].f[j]`:
+//
+// %1 = getelementptr inbounds [10 x %Rec], ptr %a, i32 0, i64 %i, i32 1, i64 %j
+//
+// Only a dereference ends a run, since it loads the next base address. No
+// intermediate aggregate is loaded; the caller loads or stores the scalar.
+//
+// Access describes the selected memory: the record of a field path, and the
+// alias scope of the variable until a pointer is followed.
+llvm::Value* CGProcedure::emitDesignatorAddress (Designator* Desig, MemAccess& Access) {
+    Decl* Var    = Desig->getDecl ();
+    TypeDecl* Ty = getDeclType (Var);
+
+    // Variables kept in SSA form have no address. The only selector that can
+    // apply to them is a dereference of the pointer they hold.
+    bool InMemory     = isInMemory (Var);
+    llvm::Value* Addr = readVariable (CurrBlk, Var, !InMemory);
+    Access            = MemAccess ();
+    Access.Scope      = getAliasScope (Var);
+
+    // The pending run: a GEP on RunTy from Addr with these indices.
+    llvm::Type* RunTy = nullptr;
+    llvm::SmallVector<llvm::Value*, 8> Indices;
+    auto EndRun = [&] () {
+        if (RunTy)
+            Addr = emitInBoundsGEP (RunTy, Addr, Indices);
+        RunTy = nullptr;
+        Indices.clear ();
+    };
+
+    for (Selector* Sel : Desig->getSelectors ()) {
+        if (auto* IdxSel = llvm::dyn_cast<IndexSelector> (Sel)) {
+            llvm::Value* Idx = visit (IdxSel->getIndex ());
+            // Narrow indices are widened first, so that the bounds check
+            // compares against the full length.
+            PervasiveTypeDecl* IdxTy = getIntegerType (IdxSel->getIndex ()->getType ());
+            Idx = Builder.CreateIntCast (Idx, CGM.Int64Ty, !IdxTy || IdxTy->isSigned ());
+            if (auto* Open = llvm::dyn_cast<OpenArrayTypeDecl> (Ty)) {
+                // An open array points to its first element.
+                auto* FP = llvm::cast<FormalParameterDecl> (Var);
+                if (BoundsCheck)
+                    emitBoundsCheck (Idx, OpenArrayLengths[FP]);
+                RunTy = CGM.convertType (Open->getType ());
+            } else {
+                auto* ArrTy = llvm::cast<llvm::ArrayType> (CGM.convertType (Ty));
+                if (BoundsCheck)
+                    emitBoundsCheck (Idx, llvm::ConstantInt::get (CGM.Int64Ty, ArrTy->getNumElements ()));
+                if (!RunTy) {
+                    RunTy = ArrTy;
+                    Indices.push_back (CGM.Int32Zero);
+                }
+            }
+            Indices.push_back (Idx);
+            // An element of an array is accessed as a scalar of its type.
+            Access.Base   = nullptr;
+            Access.Offset = 0;
+        } else if (auto* FieldSel = llvm::dyn_cast<FieldSelector> (Sel)) {
+            auto* StructTy = llvm::cast<llvm::StructType> (CGM.convertType (Ty));
+            unsigned Elem  = CGM.getFieldIndex (llvm::cast<RecordTypeDecl> (Ty), FieldSel->getIndex ());
+            if (!RunTy) {
+                RunTy = StructTy;
+                Indices.push_back (CGM.Int32Zero);
+            }
+            Indices.push_back (llvm::ConstantInt::get (CGM.Int32Ty, Elem));
+            if (!Access.Base)
+                Access.Base = Ty;
+            Access.Offset +=
+            CGM.getModule ()->getDataLayout ().getStructLayout (StructTy)->getElementOffset (Elem);
+        } else if (llvm::isa<DerefSelector> (Sel)) {
+            EndRun ();
+            if (InMemory) {
+                auto* Load = Builder.CreateLoad (Builder.getPtrTy (), Addr);
+                decorateAccess (Load, Ty, Access);
+                Addr = Load;
+            }
+            // The pointee lives on the heap, outside of any alias scope.
+            Access = MemAccess ();
+        } else {
             llvm::report_fatal_error ("Unsupported selector");
         }
+        InMemory = true;
+        Ty       = Sel->getType ();
     }
 
-    return Val;
+    EndRun ();
+    return Addr;
 }
 
+// Designators that select the same component again in a block, as in
+// `a[i].n := a[i].n + 1`, share one GEP. Its operands are SSA values, so the
+// same indices mean the same address. Loads are not shared: a pointer
+// followed by a dereference may have changed in between.
+llvm::Value*
+CGProcedure::emitInBoundsGEP (llvm::Type* Ty, llvm::Value* Addr, llvm::ArrayRef<llvm::Value*> Indices) {
+    auto& GEPs = AddressCache[{ CurrBlk, Addr }];
+    for (llvm::GetElementPtrInst* GEP : GEPs) {
+        if (GEP->getPointerOperand () == Addr && GEP->getSourceElementType () == Ty &&
+        llvm::equal (GEP->indices (), Indices))
+            return GEP;
+    }
+
+    llvm::Value* V = Builder.CreateInBoundsGEP (Ty, Addr, Indices);
+    // Constant addresses are folded and need no cache.
+    if (auto* GEP = llvm::dyn_cast<llvm::GetElementPtrInst> (V))
+        GEPs.push_back (GEP);
+    return V;
+}
 
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - CGProcedure (Emit - Stmt)
 /////////////////////////////////////////////////////////////////////////////
 
-llvm::Value* CGProcedure::operator() (const StmtList& Stmts) {
-    for (auto* S : Stmts) {
-        if (auto* Stmt = llvm::dyn_cast<AssignmentStatement> (S))
-            this->operator() (Stmt);
-        else if (auto* Stmt = llvm::dyn_cast<ProcedureCallStatement> (S))
-            this->operator() (Stmt);
-        else if (auto* Stmt = llvm::dyn_cast<IfStatement> (S))
-            this->operator() (Stmt);
-        else if (auto* Stmt = llvm::dyn_cast<WhileStatement> (S))
-            this->operator() (Stmt);
-        else if (auto* Stmt = llvm::dyn_cast<ReturnStatement> (S))
-            this->operator() (Stmt);
-        else
-            llvm_unreachable ("Unknown statement");
-    }
+llvm::Value* CGProcedure::visitAssignmentStatement (AssignmentStatement* Stmt) {
+    auto* Val = visit (Stmt->getExpr ());
+    emitStore (Stmt->getVar (), Val);
+    return Val;
 }
 
-llvm::Value* CGProcedure::operator() (AssignmentStatement* Stmt) {
-    auto* Val = this->operator() (Stmt->getExpr ());
-
-    // Write Statement out to variable
-    // Desig = Decl + Sel_Lst
-    Designator* Desig = Stmt->getVar ();
-    auto& Selectors   = Desig->getSelectors ();
-    if (Selectors.empty ()) {
+// Write Statement out to variable
+// Desig = Decl + Sel_Lst
+void CGProcedure::emitStore (Designator* Desig, llvm::Value* Val) {
+    if (Desig->getSelectors ().empty ()) {
         writeVariable (CurrBlk, Desig->getDecl (), Val);
-        return Val;
+        return;
     }
 
-    llvm::SmallVector<llvm::Value*, 4> IdxList;
-    // First index for GEP.
-    IdxList.push_back (llvm::ConstantInt::get (CGM.Int32Ty, 0));
-    auto* Base = readVariable (CurrBlk, Desig->getDecl (), false);
-    for (auto I = Selectors.begin (), E = Selectors.end (); I != E; ++I) {
-        if (auto* IdxSel = llvm::dyn_cast<IndexSelector> (*I)) {
-            IdxList.push_back (this->operator() (IdxSel->getIndex ()));
-        } else if (auto* FieldSel = llvm::dyn_cast<FieldSelector> (*I)) {
-            llvm::Value* V = llvm::ConstantInt::get (CGM.Int32Ty, FieldSel->getIndex ());
-            IdxList.push_back (V);
-        } else {
-            llvm::report_fatal_error ("not implemented");
-        }
-    }
+    MemAccess Access;
+    llvm::Value* Addr = emitDesignatorAddress (Desig, Access);
+    decorateAccess (Builder.CreateStore (Val, Addr), Desig->getType (), Access);
+}
 
-    if (!IdxList.empty ()) {
-        if (Base->getType ()->isPointerTy ()) {
-            Base = Builder.CreateInBoundsGEP (mapType (Desig->getDecl ()), Base, IdxList);
-            Builder.CreateStore (Val, Base);
-        } else {
-            llvm::report_fatal_error ("should not happen");
-        }
-    }
+// The runtime keeps no header per object: the size class follows from the
+// store size of the base type, which DISPOSE passes again.
+llvm::Value* CGProcedure::visitNewStatement (NewStatement* Stmt) {
+    Designator* Ptr    = Stmt->getPtr ();
+    TypeDecl* BaseTy   = llvm::cast<PointerTypeDecl> (Ptr->getType ())->getType ();
+    uint64_t Size      = CGM.getModule ()->getDataLayout ().getTypeStoreSize (CGM.convertType (BaseTy));
+    llvm::Value* Obj =
+    Builder.CreateCall (CGM.getNewFn (), { llvm::ConstantInt::get (CGM.Int64Ty, Size) });
+    emitStore (Ptr, Obj);
+    return Obj;
+}
 
-    return Val;
+llvm::Value* CGProcedure::visitDisposeStatement (DisposeStatement* Stmt) {
+    Designator* Ptr  = Stmt->getPtr ();
+    TypeDecl* BaseTy = llvm::cast<PointerTypeDecl> (Ptr->getType ())->getType ();
+    uint64_t Size    = CGM.getModule ()->getDataLayout ().getTypeStoreSize (CGM.convertType (BaseTy));
+    Builder.CreateCall (CGM.getDisposeFn (), { visit (Ptr), llvm::ConstantInt::get (CGM.Int64Ty, Size) });
+    emitStore (Ptr, llvm::ConstantPointerNull::get (CGM.PtrTy));
+    return nullptr;
 }
 
-llvm::Value* CGProcedure::operator() (ProcedureCallStatement* Stmt) {
-    llvm::report_fatal_error ("not implemented");
+llvm::Value* CGProcedure::visitProcedureCallStatement (ProcedureCallStatement* Stmt) {
+    return emitCall (Stmt->getProc (), Stmt->getParams ());
 }
 
-llvm::Value* CGProcedure::operator() (IfStatement* Stmt) {
+// A block is sealed as soon as all of its predecessors have been emitted.
+llvm::Value* CGProcedure::visitIfStatement (IfStatement* Stmt) {
     bool HasElse = Stmt->getElseStmts ().size () > 0;
     // Create BB's
     llvm::BasicBlock* IfBB =
@@ -236,33 +552,117 @@ llvm::Value* CGProcedure::operator() (IfStatement* Stmt) {
     llvm::BasicBlock::Create (CGM.getLLVMCtx (), "after.if", Function);
 
     // Cond Val + BranchInst
-    auto* Cond                    = this->operator() (Stmt->getCond ());
-    [[maybe_unused]] auto* CondBB = Builder.CreateCondBr (Cond, IfBB, ElseBB);
-
-    sealBlock (CurrBlk);
-    setInsertion (CurrBlk);
+    auto* Cond = visit (Stmt->getCond ());
+    Builder.CreateCondBr (Cond, IfBB, HasElse ? ElseBB : AfterIfBB);
 
     // If Val + BranchInst
-    auto* If_V = this->operator() (Stmt->getIfStmts ());
+    setInsertion (IfBB);
+    sealBlock (IfBB);
+    visit (Stmt->getIfStmts ());
     if (!CurrBlk->getTerminator ())
         Builder.CreateBr (AfterIfBB);
-    sealBlock (CurrBlk);
 
     // Else Val + BranchInst
     if (HasElse) {
         setInsertion (ElseBB);
-        [[maybe_unused]] auto* Else_Bi = this->operator() (Stmt->getElseStmts ());
+        sealBlock (ElseBB);
+        visit (Stmt->getElseStmts ());
         if (!CurrBlk->getTerminator ())
             Builder.CreateBr (AfterIfBB);
-        sealBlock (CurrBlk);
     }
+
     setInsertion (AfterIfBB);
+    sealBlock (AfterIfBB);
+    return nullptr;
+}
 
+// A CASE statement becomes a single switch, so the backend picks a jump table,
+// bit tests or a binary search for it. A range label adds a case per value.
+// Only a range too large for that is tested in front of the default
+// destination, with one compare each:
+//
+//   switch i64 %op, label %case.range [ i64 0, label %case.body ... ]
+//   case.range:
+//     %0 = sub i64 %op, 100
+//     %case.inrange = icmp ule i64 %0, 899           ; 100 .. 999
+//     br i1 %case.inrange, label %case.body3, label %case.else
+//
+// Without an ELSE part, the default is the failure block of the runtime checks.
+llvm::Value* CGProcedure::visitCaseStatement (CaseStatement* Stmt) {
+    const uint64_t MaxExpandedRange = 64;
+    llvm::LLVMContext& Ctx          = CGM.getLLVMCtx ();
+    const CaseList& Cases           = Stmt->getCases ();
+    llvm::Value* Selector           = visit (Stmt->getSelector ());
+
+    llvm::SmallVector<llvm::BasicBlock*, 8> CaseBBs;
+    llvm::SmallVector<std::pair<const CaseLabel*, llvm::BasicBlock*>, 4> Ranges;
+    uint64_t NumCases = 0;
+    for (const CaseAlternative& Alt : Cases) {
+        CaseBBs.push_back (llvm::BasicBlock::Create (Ctx, "case.body", Function));
+        for (const CaseLabel& L : Alt.Labels) {
+            llvm::APInt Span = L.High - L.Low;
+            if (Span.ult (MaxExpandedRange))
+                NumCases += Span.getZExtValue () + 1;
+            else
+                Ranges.push_back ({ &L, CaseBBs.back () });
+        }
+    }
+    llvm::BasicBlock* ElseBB =
+    Stmt->hasElse () ? llvm::BasicBlock::Create (Ctx, "case.else", Function) : nullptr;
+    llvm::BasicBlock* AfterCaseBB = llvm::BasicBlock::Create (Ctx, "after.case", Function);
+    llvm::BasicBlock* NoMatchBB   = ElseBB ? ElseBB : getTrapBlock ();
+
+    llvm::BasicBlock* RangeBB =
+    Ranges.empty () ? NoMatchBB : llvm::BasicBlock::Create (Ctx, "case.range", Function);
+    llvm::SwitchInst* Switch = Builder.CreateSwitch (Selector, RangeBB, NumCases);
+    for (size_t I = 0, E = Cases.size (); I != E; ++I) {
+        for (const CaseLabel& L : Cases[I].Labels) {
+            if ((L.High - L.Low).uge (MaxExpandedRange))
+                continue;
+            // Stops at High, which may be the largest value of the type.
+            for (llvm::APInt V = L.Low;; ++V) {
+                Switch->addCase (llvm::ConstantInt::get (Ctx, V), CaseBBs[I]);
+                if (V == L.High)
+                    break;
+            }
+        }
+    }
 
-    return If_V; // Doesn't matter for now
+    for (size_t I = 0, E = Ranges.size (); I != E; ++I) {
+        const CaseLabel* L = Ranges[I].first;
+        setInsertion (RangeBB);
+        sealBlock (RangeBB);
+        RangeBB = I + 1 == E ? NoMatchBB : llvm::BasicBlock::Create (Ctx, "case.range", Function);
+        llvm::Value* Offset = Builder.CreateSub (Selector, llvm::ConstantInt::get (Ctx, L->Low));
+        llvm::Value* InRange =
+        Builder.CreateICmpULE (Offset, llvm::ConstantInt::get (Ctx, L->High - L->Low), "case.inrange");
+        Builder.CreateCondBr (InRange, Ranges[I].second, RangeBB);
+    }
+    if (!ElseBB)
+        TrapSite->addIncoming (getCheckSite (CK_Case), CurrBlk);
+
+    // The switch and the range tests are the only predecessors of the bodies.
+    for (size_t I = 0, E = Cases.size (); I != E; ++I) {
+        setInsertion (CaseBBs[I]);
+        sealBlock (CaseBBs[I]);
+        visit (Cases[I].Stmts);
+        if (!CurrBlk->getTerminator ())
+            Builder.CreateBr (AfterCaseBB);
+    }
+    if (ElseBB) {
+        setInsertion (ElseBB);
+        sealBlock (ElseBB);
+        visit (Stmt->getElseStmts ());
+        if (!CurrBlk->getTerminator ())
+            Builder.CreateBr (AfterCaseBB);
+    }
+
+    setInsertion (AfterCaseBB);
+    sealBlock (AfterCaseBB);
+    return nullptr;
 }
 
-llvm::Value* CGProcedure::operator() (WhileStatement* Stmt) {
+llvm::Value* CGProcedure::visitWhileStatement (WhileStatement* Stmt) {
     // Condition Block + BranchInst
     llvm::BasicBlock* WhileCondBB =
     llvm::BasicBlock::Create (CGM.getLLVMCtx (), "while.cond", Function);
@@ -273,97 +673,799 @@ llvm::Value* CGProcedure::operator() (WhileStatement* Stmt) {
     llvm::BasicBlock* AfterWhileBB =
     llvm::BasicBlock::Create (CGM.getLLVMCtx (), "after.while", Function);
 
-    [[maybe_unused]] auto* While_Cond_BR = Builder.CreateBr (WhileCondBB);
-    sealBlock (CurrBlk);
+    Builder.CreateBr (WhileCondBB);
+    // The back edge from the body is still missing, so the condition block
+    // stays unsealed until the body has been emitted.
     setInsertion (WhileCondBB);
-    llvm::Value* Cond = this->operator() (Stmt->getCond ());
+    llvm::Value* Cond = visit (Stmt->getCond ());
     Builder.CreateCondBr (Cond, WhileBodyBB, AfterWhileBB);
 
     setInsertion (WhileBodyBB);
-    this->operator() (Stmt->getStmts ());
-    [[maybe_unused]] auto* While_Block_BR = Builder.CreateBr (WhileCondBB);
-
+    sealBlock (WhileBodyBB);
+    visit (Stmt->getStmts ());
+    if (!CurrBlk->getTerminator ())
+        Builder.CreateBr (WhileCondBB);
     sealBlock (WhileCondBB);
-    sealBlock (CurrBlk);
+
     setInsertion (AfterWhileBB);
+    sealBlock (AfterWhileBB);
+    return nullptr;
 }
 
-llvm::Value* CGProcedure::operator() (ReturnStatement* Stmt) {
+// A FOR loop is emitted in rotated form, with the exit test at the bottom:
+//
+// entry:    if Start <= End goto for.body else after.for   (>= for a negative step)
+// for.body: i = phi [Start, entry], [i.next, latch]
+//           ...
+// latch:    i.next = add nsw i, Step
+//           if i == Last goto after.for else for.body
+//
+// Last is the final value of i, Start + ((End - Start) / Step) * Step. Testing
+// i against it instead of End means that i.next never overflows when the back
+// edge is taken, so the increment is nsw and SCEV gets an exact trip count.
+llvm::Value* CGProcedure::visitForStatement (ForStatement* Stmt) {
+    VariableDecl* Var     = Stmt->getVar ();
+    int64_t Step          = Stmt->getStep ();
+    llvm::Value* Start    = visit (Stmt->getStart ());
+    llvm::Value* End      = visit (Stmt->getEnd ());
+    llvm::Constant* StepC = llvm::ConstantInt::get (CGM.Int64Ty, Step, true);
+
+    // End - Start may not fit into a signed integer, but always fits into an
+    // unsigned one; Last itself is computed in wrapping arithmetic.
+    llvm::Value* Last = End;
+    if (Step != 1 && Step != -1) {
+        uint64_t Stride    = Step > 0 ? Step : 0 - static_cast<uint64_t> (Step);
+        llvm::Value* Dist  = Step > 0 ? Builder.CreateSub (End, Start) : Builder.CreateSub (Start, End);
+        llvm::Value* Trips = Builder.CreateUDiv (Dist, llvm::ConstantInt::get (CGM.Int64Ty, Stride));
+        Last               = Builder.CreateAdd (Start, Builder.CreateMul (Trips, StepC), "for.last");
+    }
+    llvm::Value* Enter =
+    Step > 0 ? Builder.CreateICmpSLE (Start, End) : Builder.CreateICmpSGE (Start, End);
+
+    llvm::BasicBlock* ForBodyBB =
+    llvm::BasicBlock::Create (CGM.getLLVMCtx (), "for.body", Function);
+    llvm::BasicBlock* AfterForBB =
+    llvm::BasicBlock::Create (CGM.getLLVMCtx (), "after.for", Function);
+
+    writeVariable (CurrBlk, Var, Start);
+    Builder.CreateCondBr (Enter, ForBodyBB, AfterForBB);
+
+    // The header stays unsealed until the back edge exists.
+    setInsertion (ForBodyBB);
+    visit (Stmt->getStmts ());
+    if (!CurrBlk->getTerminator ()) {
+        // The body can't assign the control variable, so this is the phi.
+        llvm::Value* IV   = readVariable (CurrBlk, Var);
+        llvm::Value* Next = Builder.CreateNSWAdd (IV, StepC, "for.next");
+        writeVariable (CurrBlk, Var, Next);
+        auto* Latch = Builder.CreateCondBr (Builder.CreateICmpEQ (IV, Last), AfterForBB, ForBodyBB);
+        Latch->setMetadata (llvm::LLVMContext::MD_loop, createLoopMetadata ());
+
+        // In the body, i runs from Start to Last. A constant bound is a fact
+        // for the bounds checks on i, which no dominating condition states.
+        auto* StartC = llvm::dyn_cast<llvm::ConstantInt> (Start);
+        auto* LastC  = llvm::dyn_cast<llvm::ConstantInt> (Last);
+        if (StartC || LastC) {
+            int64_t Lower = std::numeric_limits<int64_t>::min ();
+            int64_t Upper = std::numeric_limits<int64_t>::max ();
+            auto* LowC    = Step > 0 ? StartC : LastC;
+            auto* HighC   = Step > 0 ? LastC : StartC;
+            if (LowC)
+                Lower = LowC->getSExtValue ();
+            if (HighC)
+                Upper = HighC->getSExtValue ();
+            InductionRanges[IV] = { Lower, Upper };
+        }
+    }
+    sealBlock (ForBodyBB);
+
+    setInsertion (AfterForBB);
+    sealBlock (AfterForBB);
+    return nullptr;
+}
+
+// A counted loop terminates, so it is marked as mustprogress; the optional
+// hints show up in -pass-remarks(-missed)=loop-vectorize|loop-unroll.
+llvm::MDNode* CGProcedure::createLoopMetadata () {
+    llvm::LLVMContext& Ctx = CGM.getLLVMCtx ();
+    auto Hint              = [&] (llvm::StringRef Name, llvm::Metadata* Val = nullptr) {
+        llvm::SmallVector<llvm::Metadata*, 2> Ops{ llvm::MDString::get (Ctx, Name) };
+        if (Val)
+            Ops.push_back (Val);
+        return llvm::MDNode::get (Ctx, Ops);
+    };
+    auto Int = [&] (llvm::Type* Ty, uint64_t V) {
+        return llvm::ConstantAsMetadata::get (llvm::ConstantInt::get (Ty, V));
+    };
+
+    // The first operand refers to the loop ID itself.
+    llvm::SmallVector<llvm::Metadata*, 4> Ops{ nullptr, Hint ("llvm.loop.mustprogress") };
+    if (LoopVectorizeWidth) {
+        Ops.push_back (Hint ("llvm.loop.vectorize.enable", Int (CGM.Int1Ty, 1)));
+        Ops.push_back (Hint ("llvm.loop.vectorize.width", Int (CGM.Int32Ty, LoopVectorizeWidth)));
+    }
+    if (LoopUnrollCount)
+        Ops.push_back (Hint ("llvm.loop.unroll.count", Int (CGM.Int32Ty, LoopUnrollCount)));
+
+    llvm::MDNode* LoopID = llvm::MDNode::getDistinct (Ctx, Ops);
+    LoopID->replaceOperandWith (0, LoopID);
+    return LoopID;
+}
+
+llvm::Value* CGProcedure::visitReturnStatement (ReturnStatement* Stmt) {
     if (Stmt->getExpr ()) {
-        auto* V = this->operator() (Stmt->getExpr ());
+        // A large result is copied straight into the caller's slot.
+        const ABIArgInfo& Ret = FnInfo->Ret;
+        if (Ret.isIndirect ()) {
+            const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
+            llvm::Value* Src           = emitAggregateAddress (Stmt->getExpr ());
+            Builder.CreateMemCpy (SRetArg, Ret.getAlign (), Src, Ret.getAlign (),
+            DL.getTypeStoreSize (Ret.getType ()).getFixedValue ());
+            return Builder.CreateRetVoid ();
+        }
+        if (Ret.isCoerce ())
+            return Builder.CreateRet (loadCoerced (emitAggregateAddress (Stmt->getExpr ()), Ret));
+
+        auto* V = visit (Stmt->getExpr ());
+        if (llvm::isa<FunctionCallExpr> (Stmt->getExpr ()))
+            markTailCall (V);
         return Builder.CreateRet (V);
     }
 
     return Builder.CreateRetVoid ();
 }
 
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - CGProcedure (Calls and Exceptions)
+/////////////////////////////////////////////////////////////////////////////
+
+// VAR arguments are passed by address. A value parameter kept in SSA form has
+// no address, so it is passed through a temporary, which is read back after
+// the call. Inside TRY, EffectAnalysis gives such a parameter a stack slot,
+// as the copy back would be skipped by an exception. Aggregates follow CGABIInfo: a byval argument is the address of
+// the value, which the call copies, and an sret result goes to a temporary.
+llvm::Value* CGProcedure::emitCall (ProcedureDecl* Proc, const ExprList& Args) {
+    const ABIFunctionInfo& Info = CGM.getABIInfo ().getFunctionInfo (Proc);
+    llvm::Function* Callee      = createFunction (Proc, Info.FnTy);
+
+    llvm::SmallVector<llvm::Value*, 8> ArgVals;
+    llvm::SmallVector<std::pair<Decl*, llvm::AllocaInst*>, 2> CopyBack;
+    llvm::AllocaInst* SRet = nullptr;
+    if (Info.Ret.isIndirect ()) {
+        SRet = createTemporary (Info.Ret.getType (), "sret");
+        ArgVals.push_back (SRet);
+    }
+    for (auto [FP, Arg, AI] : llvm::zip (Proc->getFormalParams (), Args, Info.Params)) {
+        if (FP->isOpenArray ()) {
+            emitOpenArrayArg (llvm::cast<Designator> (Arg), ArgVals);
+            continue;
+        }
+        if (!FP->isVar ()) {
+            if (AI.isIndirect ())
+                ArgVals.push_back (emitAggregateAddress (Arg));
+            else if (AI.isCoerce ())
+                ArgVals.push_back (loadCoerced (emitAggregateAddress (Arg), AI));
+            else
+                ArgVals.push_back (visit (Arg));
+            continue;
+        }
+
+        auto* Desig = llvm::cast<Designator> (Arg);
+        Decl* Var   = Desig->getDecl ();
+        if (!Desig->getSelectors ().empty ()) {
+            MemAccess Access;
+            ArgVals.push_back (emitDesignatorAddress (Desig, Access));
+        } else if (isInMemory (Var)) {
+            ArgVals.push_back (readVariable (CurrBlk, Var, false));
+        } else {
+            auto* Tmp = createTemporary (mapType (Var), Var->getName ());
+            Builder.CreateStore (readVariable (CurrBlk, Var), Tmp);
+            ArgVals.push_back (Tmp);
+            CopyBack.push_back ({ Var, Tmp });
+        }
+    }
+
+    // The backend reads byval, sret and the calling convention from the call
+    // site. Only the parameter and result attributes are copied: the memory
+    // effects of the callee stay on its declaration, where the driver can
+    // drop them when -fprofile-generate adds counters.
+    llvm::CallBase* Call         = createCallOrInvoke (Callee, ArgVals);
+    const llvm::AttributeList& Fn = Callee->getAttributes ();
+    llvm::SmallVector<llvm::AttributeSet, 8> ParamAttrs;
+    for (unsigned I = 0, E = ArgVals.size (); I != E; ++I)
+        ParamAttrs.push_back (Fn.getParamAttrs (I));
+    Call->setAttributes (llvm::AttributeList::get (
+    CGM.getLLVMCtx (), llvm::AttributeSet (), Fn.getRetAttrs (), ParamAttrs));
+    Call->setCallingConv (Callee->getCallingConv ());
+    for (auto [Var, Tmp] : CopyBack)
+        writeVariable (CurrBlk, Var, Builder.CreateLoad (Tmp->getAllocatedType (), Tmp));
+
+    if (SRet)
+        return Builder.CreateLoad (Info.Ret.getType (), SRet);
+    if (Info.Ret.isCoerce ()) {
+        auto* Tmp = createTemporary (Info.Ret.getType (), "coerce");
+        storeCoerced (Call, Tmp, Info.Ret);
+        return Builder.CreateLoad (Info.Ret.getType (), Tmp);
+    }
+    return Call;
+}
+
+// musttail requires the caller and the call site to agree on every attribute
+// that changes how an argument or the result is passed, not only on the type:
+// a VAR parameter and a byval one are both a ptr.
+static bool hasSameABIAttributes (const llvm::CallBase* Call, const llvm::Function* Caller) {
+    static const llvm::Attribute::AttrKind ABIKinds[] = { llvm::Attribute::ByVal,
+        llvm::Attribute::StructRet, llvm::Attribute::InReg, llvm::Attribute::Alignment,
+        llvm::Attribute::StackAlignment, llvm::Attribute::ByRef, llvm::Attribute::InAlloca,
+        llvm::Attribute::Preallocated, llvm::Attribute::ZExt, llvm::Attribute::SExt };
+    auto Same = [] (llvm::AttributeSet A, llvm::AttributeSet B) {
+        for (llvm::Attribute::AttrKind Kind : ABIKinds)
+            if (A.getAttribute (Kind) != B.getAttribute (Kind))
+                return false;
+        return true;
+    };
+
+    const llvm::AttributeList CallAttrs   = Call->getAttributes ();
+    const llvm::AttributeList CallerAttrs = Caller->getAttributes ();
+    if (!Same (CallAttrs.getRetAttrs (), CallerAttrs.getRetAttrs ()))
+        return false;
+    for (unsigned I = 0, E = Call->arg_size (); I != E; ++I)
+        if (!Same (CallAttrs.getParamAttrs (I), CallerAttrs.getParamAttrs (I)))
+            return false;
+    return true;
+}
+
+// The result of a call that is returned right away makes it a tail call,
+// unless the callee may unwind into a handler here or is passed memory of this
+// frame. Between procedures that pass their arguments and result the same way,
+// e.g. in self recursion, the call becomes musttail, so the stack doesn't grow
+// however deep it recurses.
+void CGProcedure::markTailCall (llvm::Value* V) {
+    auto* Call = llvm::dyn_cast<llvm::CallInst> (V);
+    if (!Call || Call != &CurrBlk->back ())
+        return; // An invoke, or something follows, e.g. the copy back of VAR arguments
+
+    for (llvm::Value* Arg : Call->args ()) {
+        const llvm::Value* Obj = llvm::getUnderlyingObject (Arg);
+        if (llvm::isa<llvm::AllocaInst> (Obj))
+            return;
+        if (auto* A = llvm::dyn_cast<llvm::Argument> (Obj); A && A->hasByValAttr ())
+            return;
+    }
+
+    llvm::Function* Callee = Call->getCalledFunction ();
+    bool SameSignature     = Callee->getFunctionType () == Function->getFunctionType () &&
+    Callee->getCallingConv () == Function->getCallingConv () &&
+    hasSameABIAttributes (Call, Function);
+    Call->setTailCallKind (SameSignature ? llvm::CallInst::TCK_MustTail : llvm::CallInst::TCK_Tail);
+}
+
+// Aggregates are passed on through their address, so they needn't be loaded
+// as a whole. One that is not a variable, e.g. the result of a function call,
+// is spilled to a temporary.
+llvm::Value* CGProcedure::emitAggregateAddress (Expr* E) {
+    if (auto* Desig = llvm::dyn_cast<Designator> (E)) {
+        if (Desig->getSelectors ().empty ())
+            return readVariable (CurrBlk, Desig->getDecl (), false);
+        MemAccess Access;
+        return emitDesignatorAddress (Desig, Access);
+    }
+
+    llvm::Value* Val = visit (E);
+    auto* Tmp        = createTemporary (Val->getType (), "agg.tmp");
+    Builder.CreateStore (Val, Tmp);
+    return Tmp;
+}
+
+// A coerced aggregate is accessed as an integer of its store size, which is
+// no larger than the memory it lives in.
+llvm::Value* CGProcedure::loadCoerced (llvm::Value* Addr, const ABIArgInfo& AI) {
+    const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
+    return Builder.CreateAlignedLoad (AI.getIRType (), Addr, DL.getABITypeAlign (AI.getType ()));
+}
+
+void CGProcedure::storeCoerced (llvm::Value* Val, llvm::Value* Addr, const ABIArgInfo& AI) {
+    const llvm::DataLayout& DL = CGM.getModule ()->getDataLayout ();
+    Builder.CreateAlignedStore (Val, Addr, DL.getABITypeAlign (AI.getType ()));
+}
+
+// Temporaries are allocated in the entry block, once per call of the
+// procedure, where SROA can promote them.
+llvm::AllocaInst* CGProcedure::createTemporary (llvm::Type* Ty, const llvm::Twine& Name) {
+    llvm::BasicBlock& Entry = Function->getEntryBlock ();
+    llvm::IRBuilder<> EntryBuilder (&Entry, Entry.begin ());
+    return EntryBuilder.CreateAlloca (Ty, nullptr, Name);
+}
+
+// Passes the address of the first element and the length. An array always
+// lives in memory, and it is not copied, not even for a value parameter.
+void CGProcedure::emitOpenArrayArg (Designator* Desig, llvm::SmallVectorImpl<llvm::Value*>& ArgVals) {
+    if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Desig->getDecl ());
+        FP && FP->isOpenArray () && Desig->getSelectors ().empty ()) {
+        ArgVals.push_back (FormalParams[FP]);
+        ArgVals.push_back (OpenArrayLengths[FP]);
+        return;
+    }
+
+    auto* ArrTy = llvm::cast<llvm::ArrayType> (CGM.convertType (Desig->getType ()));
+    ArgVals.push_back (emitAggregateAddress (Desig));
+    ArgVals.push_back (llvm::ConstantInt::get (CGM.Int64Ty, ArrTy->getNumElements ()));
+}
+
+// Inside a TRY statement, a call that may unwind becomes an invoke, which
+// continues in a new block. Everywhere else it stays a plain call.
+llvm::CallBase*
+CGProcedure::createCallOrInvoke (llvm::FunctionCallee Callee, llvm::ArrayRef<llvm::Value*> Args) {
+    auto* Fn = llvm::dyn_cast<llvm::Function> (Callee.getCallee ());
+    if (TryScopes.empty () || (Fn && Fn->doesNotThrow ()))
+        return Builder.CreateCall (Callee, Args);
+
+    TryScope* Scope = TryScopes.back ();
+    if (!Scope->LandingPad) {
+        Scope->LandingPad = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "lpad", Function);
+        Function->setPersonalityFn (CGM.getEh ().getPersonalityFn ());
+    }
+
+    llvm::BasicBlock* ContBB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "invoke.cont", Function);
+    llvm::InvokeInst* Invoke = Builder.CreateInvoke (Callee, ContBB, Scope->LandingPad, Args);
+    setInsertion (ContBB);
+    sealBlock (ContBB);
+    return Invoke;
+}
+
+llvm::Value* CGProcedure::visitRaiseStatement (RaiseStatement* Stmt) {
+    CGEh& Eh = CGM.getEh ();
+
+    // The exception object carries no value, but may not be empty.
+    llvm::Value* Exn =
+    Builder.CreateCall (Eh.getAllocateExceptionFn (), { llvm::ConstantInt::get (CGM.Int64Ty, 1) });
+    createCallOrInvoke (Eh.getThrowFn (),
+    { Exn, Eh.getTypeInfo (Stmt->getException ()), llvm::ConstantPointerNull::get (CGM.PtrTy) });
+    return Builder.CreateUnreachable ();
+}
+
+// The handlers are emitted after the body, outside of the TRY region. A
+// handler that no landing pad branches to is dropped; without any call that
+// may unwind inside, the TRY statement costs nothing at all.
+llvm::Value* CGProcedure::visitTryStatement (TryStatement* Stmt) {
+    TryScope Scope{ Stmt };
+    for (size_t I = 0, E = Stmt->getHandlers ().size (); I != E; ++I)
+        Scope.HandlerBlocks.push_back (llvm::BasicBlock::Create (CGM.getLLVMCtx (), "except", Function));
+    if (Stmt->hasElse ())
+        Scope.ElseBlock = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "except.else", Function);
+    llvm::BasicBlock* AfterTryBB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "after.try", Function);
+
+    TryScopes.push_back (&Scope);
+    visit (Stmt->getStmts ());
+    if (!CurrBlk->getTerminator ())
+        Builder.CreateBr (AfterTryBB);
+    if (Scope.LandingPad)
+        emitLandingPad (Scope.LandingPad);
+    TryScopes.pop_back ();
+
+    auto EmitHandler = [&] (llvm::BasicBlock* BB, const StmtList& Stmts) {
+        if (llvm::pred_empty (BB)) {
+            BB->eraseFromParent ();
+            return;
+        }
+        setInsertion (BB);
+        sealBlock (BB);
+        visit (Stmts);
+        if (!CurrBlk->getTerminator ())
+            Builder.CreateBr (AfterTryBB);
+    };
+    for (auto [Handler, BB] : llvm::zip (Stmt->getHandlers (), Scope.HandlerBlocks))
+        EmitHandler (BB, Handler.Stmts);
+    if (Scope.ElseBlock)
+        EmitHandler (Scope.ElseBlock, Stmt->getElseStmts ());
+
+    setInsertion (AfterTryBB);
+    sealBlock (AfterTryBB);
+    return nullptr;
+}
+
+/**
+ * Emits the landing pad of the innermost TRY statement.
+ *
+ * The landing pad catches the exceptions of all enclosing TRY statements of
+ * the procedure, as `resume` would leave the procedure. So it is only entered
+ * for an exception that one of them handles: the exception is finished right
+ * away, since it carries no value, and the selector picks the handler,
+ * innermost first.
+ *
+ * @param LandingPad The unwind destination of the invokes in the TRY statement.
+ */
+void CGProcedure::emitLandingPad (llvm::BasicBlock* LandingPad) {
+    CGEh& Eh = CGM.getEh ();
+    setInsertion (LandingPad);
+    sealBlock (LandingPad);
+
+    auto* LPadTy             = llvm::StructType::get (CGM.PtrTy, CGM.Int32Ty);
+    llvm::LandingPadInst* LP = Builder.CreateLandingPad (LPadTy, 0);
+    for (TryScope* Scope : llvm::reverse (TryScopes)) {
+        for (const ExceptHandler& Handler : Scope->Stmt->getHandlers ())
+            LP->addClause (Eh.getTypeInfo (Handler.Exc));
+        if (Scope->ElseBlock) {
+            LP->addClause (llvm::ConstantPointerNull::get (CGM.PtrTy)); // catch-all
+            break;
+        }
+    }
+
+    llvm::Value* Exn = Builder.CreateExtractValue (LP, 0);
+    llvm::Value* Sel = Builder.CreateExtractValue (LP, 1);
+    Builder.CreateCall (Eh.getBeginCatchFn (), { Exn });
+    Builder.CreateCall (Eh.getEndCatchFn ());
+
+    for (TryScope* Scope : llvm::reverse (TryScopes)) {
+        for (auto [Handler, BB] : llvm::zip (Scope->Stmt->getHandlers (), Scope->HandlerBlocks)) {
+            llvm::Value* TypeId = Builder.CreateIntrinsic (llvm::Intrinsic::eh_typeid_for,
+            { CGM.PtrTy }, { Eh.getTypeInfo (Handler.Exc) });
+            llvm::BasicBlock* NextBB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "catch.next", Function);
+            Builder.CreateCondBr (Builder.CreateICmpEQ (Sel, TypeId), BB, NextBB);
+            setInsertion (NextBB);
+            sealBlock (NextBB);
+        }
+        if (Scope->ElseBlock) {
+            Builder.CreateBr (Scope->ElseBlock);
+            return;
+        }
+    }
+    Builder.CreateUnreachable ();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - CGProcedure (Runtime Checks)
+/////////////////////////////////////////////////////////////////////////////
+
+// Continues in a new block if Ok holds. Otherwise control goes to the
+// shared failure block, with the site of this check added to its phi. The
+// branch is weighted, so the block is laid out cold, away from the hot path,
+// which is just the compare and an untaken branch.
+llvm::BranchInst* CGProcedure::emitCheck (llvm::Value* Ok, CheckKind Kind) {
+    llvm::ConstantInt* Site = getCheckSite (Kind);
+
+    llvm::BasicBlock* ContBB = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "check.cont", Function);
+    auto* Br = Builder.CreateCondBr (Ok, ContBB, getTrapBlock (),
+    llvm::MDBuilder (CGM.getLLVMCtx ()).createLikelyBranchWeights ());
+    TrapSite->addIncoming (Site, CurrBlk);
+
+    setInsertion (ContBB);
+    sealBlock (ContBB);
+    return Br;
+}
+
+llvm::ConstantInt* CGProcedure::getCheckSite (CheckKind Kind) {
+    unsigned Line = CGM.getASTCtx ().getSourceMgr ().FindLineNumber (CurLoc);
+    return llvm::ConstantInt::get (llvm::cast<llvm::IntegerType> (CGM.Int32Ty), Line << 4 | Kind);
+}
+
+// Emits `Idx u< Len`. A negative index wraps around to a huge unsigned value,
+// so a single compare covers both ends. The length of an open array is only
+// known at run time.
+void CGProcedure::emitBoundsCheck (llvm::Value* Idx, llvm::Value* Len) {
+    auto* C      = llvm::dyn_cast<llvm::ConstantInt> (Idx);
+    auto* ConstN = llvm::dyn_cast<llvm::ConstantInt> (Len);
+    if (C && ConstN && C->getValue ().ult (ConstN->getValue ()))
+        return;
+
+    llvm::Value* InRange = Builder.CreateICmpULT (Idx, Len, "bounds.ok");
+    BoundsChecks.push_back (emitCheck (InRange, CK_Bounds));
+}
+
+void CGProcedure::emitDivCheck (llvm::Value* Divisor) {
+    if (!DivCheck)
+        return;
+    if (auto* C = llvm::dyn_cast<llvm::ConstantInt> (Divisor); C && !C->isZero ())
+        return;
+
+    emitCheck (Builder.CreateIsNotNull (Divisor, "div.ok"), CK_DivByZero);
+}
+
+llvm::BasicBlock* CGProcedure::getTrapBlock () {
+    if (TrapBlock)
+        return TrapBlock;
+
+    TrapBlock = llvm::BasicBlock::Create (CGM.getLLVMCtx (), "check.fail", Function);
+    llvm::IRBuilder<> TrapBuilder (TrapBlock);
+    TrapSite = TrapBuilder.CreatePHI (CGM.Int32Ty, 4, "site");
+    TrapBuilder.CreateCall (CGM.getCheckFailedFn (), { TrapSite });
+    TrapBuilder.CreateUnreachable ();
+    return TrapBlock;
+}
+
+/**
+ * Removes the bounds checks that can be proven to never fail.
+ *
+ * This runs after the whole procedure has been emitted, so all phis are
+ * complete and the dominator tree is final. An index is known to be in range
+ * if it is a constant, or if it is non-negative and a dominating condition
+ * (e.g. the condition of the enclosing WHILE loop) or the constant bounds of
+ * the FOR loop it controls bound it by the length.
+ */
+void CGProcedure::eliminateBoundsChecks () {
+    if (BoundsChecks.empty ())
+        return;
+
+    llvm::DominatorTree DT (*Function);
+    for (llvm::BranchInst* Br : BoundsChecks) {
+        auto* Cmp = llvm::dyn_cast<llvm::ICmpInst> (Br->getCondition ());
+        auto* Len = Cmp ? llvm::dyn_cast<llvm::ConstantInt> (Cmp->getOperand (1)) : nullptr;
+        if (!Len)
+            continue;
+
+        if (!isIndexInRange (Cmp->getOperand (0), Len->getZExtValue (), Br->getParent (), DT))
+            continue;
+
+        TrapBlock->removePredecessor (Br->getParent (), /*KeepOneInputPHIs=*/true);
+        llvm::BranchInst::Create (Br->getSuccessor (0), Br);
+        Br->eraseFromParent ();
+        if (Cmp->use_empty ())
+            Cmp->eraseFromParent ();
+    }
+
+    if (TrapBlock && llvm::pred_empty (TrapBlock)) {
+        TrapBlock->eraseFromParent ();
+        TrapBlock = nullptr;
+    }
+}
+
+bool CGProcedure::isIndexInRange (llvm::Value* Idx,
+uint64_t Len,
+llvm::BasicBlock* BB,
+const llvm::DominatorTree& DT) {
+    if (auto* C = llvm::dyn_cast<llvm::ConstantInt> (Idx))
+        return C->getValue ().ult (Len);
+    if (!Idx->getType ()->isIntegerTy (64))
+        return false;
+
+    llvm::SmallPtrSet<llvm::PHINode*, 8> Visited;
+    int64_t Lower = isKnownNonNegative (Idx, Visited) ? 0 : std::numeric_limits<int64_t>::min ();
+    int64_t Upper = std::numeric_limits<int64_t>::max ();
+    if (auto It = InductionRanges.find (Idx); It != InductionRanges.end ()) {
+        Lower = std::max (Lower, It->second.first);
+        Upper = std::min (Upper, It->second.second);
+    }
+
+    // Every conditional edge that dominates the check contributes a fact.
+    for (auto* Node = DT.getNode (BB); Node; Node = Node->getIDom ()) {
+        llvm::BasicBlock* Dom = Node->getBlock ();
+        auto* Br              = llvm::dyn_cast<llvm::BranchInst> (Dom->getTerminator ());
+        if (!Br || !Br->isConditional ())
+            continue;
+        for (unsigned I = 0; I < 2; ++I)
+            if (DT.dominates (llvm::BasicBlockEdge (Dom, Br->getSuccessor (I)), BB))
+                applyCondition (Br->getCondition (), I == 0, Idx, Lower, Upper);
+    }
+
+    return Lower >= 0 && static_cast<uint64_t> (Upper) < Len;
+}
+
+// Phis are assumed to be non-negative while their operands are checked, which
+// proves induction variables that start at a non-negative value and are
+// incremented by `add nsw`.
+bool CGProcedure::isKnownNonNegative (llvm::Value* V, llvm::SmallPtrSetImpl<llvm::PHINode*>& Visited) {
+    if (auto* C = llvm::dyn_cast<llvm::ConstantInt> (V))
+        return !C->isNegative ();
+    if (llvm::isa<llvm::ZExtInst> (V))
+        return true;
+    if (auto* SExt = llvm::dyn_cast<llvm::SExtInst> (V))
+        return isKnownNonNegative (SExt->getOperand (0), Visited);
+
+    if (auto* Phi = llvm::dyn_cast<llvm::PHINode> (V)) {
+        if (!Visited.insert (Phi).second)
+            return true;
+        return llvm::all_of (Phi->incoming_values (),
+        [&] (llvm::Value* In) { return isKnownNonNegative (In, Visited); });
+    }
+
+    if (auto* BO = llvm::dyn_cast<llvm::BinaryOperator> (V)) {
+        bool IsNSWArith = (BO->getOpcode () == llvm::Instruction::Add ||
+                          BO->getOpcode () == llvm::Instruction::Mul) &&
+        BO->hasNoSignedWrap ();
+        if (IsNSWArith)
+            return isKnownNonNegative (BO->getOperand (0), Visited) &&
+            isKnownNonNegative (BO->getOperand (1), Visited);
+    }
+    return false;
+}
+
+// Narrows [Lower, Upper] of V by a condition that is known to be IsTrue.
+void CGProcedure::applyCondition (llvm::Value* Cond, bool IsTrue, llvm::Value* V, int64_t& Lower, int64_t& Upper) {
+    // Both operands hold for a true AND and are both false for a false OR.
+    // The logical forms also match the selects emitShortCircuit builds for
+    // cheap operands.
+    using namespace llvm::PatternMatch;
+    llvm::Value *A, *B;
+    if (match (Cond, m_LogicalAnd (m_Value (A), m_Value (B)))) {
+        if (IsTrue) {
+            applyCondition (A, IsTrue, V, Lower, Upper);
+            applyCondition (B, IsTrue, V, Lower, Upper);
+        }
+        return;
+    }
+    if (match (Cond, m_LogicalOr (m_Value (A), m_Value (B)))) {
+        if (!IsTrue) {
+            applyCondition (A, IsTrue, V, Lower, Upper);
+            applyCondition (B, IsTrue, V, Lower, Upper);
+        }
+        return;
+    }
+
+    auto* Cmp = llvm::dyn_cast<llvm::ICmpInst> (Cond);
+    if (!Cmp)
+        return;
+
+    llvm::CmpInst::Predicate Pred = IsTrue ? Cmp->getPredicate () : Cmp->getInversePredicate ();
+    llvm::Value* LHS              = Cmp->getOperand (0);
+    llvm::Value* RHS              = Cmp->getOperand (1);
+    if (RHS == V) {
+        std::swap (LHS, RHS);
+        Pred = llvm::CmpInst::getSwappedPredicate (Pred);
+    }
+    auto* C = llvm::dyn_cast<llvm::ConstantInt> (RHS);
+    if (LHS != V || !C)
+        return;
+
+    constexpr int64_t Min = std::numeric_limits<int64_t>::min ();
+    constexpr int64_t Max = std::numeric_limits<int64_t>::max ();
+    int64_t K             = C->getSExtValue ();
+    switch (Pred) {
+    case llvm::CmpInst::ICMP_EQ:
+        Lower = std::max (Lower, K);
+        Upper = std::min (Upper, K);
+        break;
+    case llvm::CmpInst::ICMP_SLT:
+        if (K != Min)
+            Upper = std::min (Upper, K - 1);
+        break;
+    case llvm::CmpInst::ICMP_SLE: Upper = std::min (Upper, K); break;
+    case llvm::CmpInst::ICMP_SGT:
+        if (K != Max)
+            Lower = std::max (Lower, K + 1);
+        break;
+    case llvm::CmpInst::ICMP_SGE: Lower = std::max (Lower, K); break;
+    case llvm::CmpInst::ICMP_ULT:
+        if (K > 0) {
+            Lower = std::max<int64_t> (Lower, 0);
+            Upper = std::min (Upper, K - 1);
+        }
+        break;
+    case llvm::CmpInst::ICMP_ULE:
+        if (K >= 0) {
+            Lower = std::max<int64_t> (Lower, 0);
+            Upper = std::min (Upper, K);
+        }
+        break;
+    default: break;
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - CGProcedure (Read/Write Vars)
 /////////////////////////////////////////////////////////////////////////////
 
 void CGProcedure::writeVariable (llvm::BasicBlock* BB, Decl* Decl, llvm::Value* Val) {
+    if (auto* Slot = Addresses.lookup (Decl)) {
+        Builder.CreateStore (Val, Slot);
+        return;
+    }
+
     if (auto* V = llvm::dyn_cast<VariableDecl> (Decl)) {
         if (V->getEnclosingDecl () == ProcDecl)
-            writeLocalVariable (BB, Decl, Val);
-        else // enclosingDecl => Module
-            Builder.CreateStore (Val, CGM.getGlobal (Decl));
+            writeLocalVariable (BB, getSlot (Decl), Val);
+        else { // enclosingDecl => Module
+            MemAccess Access;
+            Access.Scope = getAliasScope (Decl);
+            decorateAccess (Builder.CreateStore (Val, CGM.getGlobal (Decl)), V->getType (), Access);
+        }
     } else if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Decl)) {
-        if (FP->isVar ())
-            Builder.CreateStore (Val, FormalParams[FP]);
-        else
-            writeLocalVariable (BB, Decl, Val);
+        if (FP->isVar ()) {
+            MemAccess Access;
+            Access.Scope = getAliasScope (Decl);
+            decorateAccess (Builder.CreateStore (Val, FormalParams[FP]), FP->getType (), Access);
+        } else
+            writeLocalVariable (BB, getSlot (Decl), Val);
     }
 }
 
+// With LoadVal == false, the address of a variable kept in memory is returned.
 llvm::Value* CGProcedure::readVariable (llvm::BasicBlock* BB, Decl* Decl, bool LoadVal) {
+    if (llvm::Value* Slot = Addresses.lookup (Decl))
+        return LoadVal ? Builder.CreateLoad (mapType (Decl), Slot) : Slot;
+
+    if (auto* C = llvm::dyn_cast<ConstantDecl> (Decl)) {
+        llvm::GlobalVariable* Table = CGM.getConstant (C);
+        if (!LoadVal)
+            return Table;
+        return Builder.CreateLoad (Table->getValueType (), Table);
+    }
+
     if (auto* V = llvm::dyn_cast<VariableDecl> (Decl)) {
         if (V->getEnclosingDecl () == ProcDecl)
-            return readLocalVariable (BB, Decl);
+            return readLocalVariable (BB, getSlot (Decl));
 
         if (V->getEnclosingDecl () == CGM.getModuleDeclaration ()) { // enclosingDecl => Module
             auto* Global = CGM.getGlobal (Decl);
-            if (LoadVal)
-                Builder.CreateLoad (mapType (Decl), Global);
-            return Global;
+            if (!LoadVal)
+                return Global;
+
+            MemAccess Access;
+            Access.Scope = getAliasScope (Decl);
+            auto* Load   = Builder.CreateLoad (mapType (Decl), Global);
+            decorateAccess (Load, V->getType (), Access);
+            return Load;
         }
     } else if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Decl)) {
-        if (FP->isVar ()) {
-            if (LoadVal)
-                Builder.CreateLoad (mapType (Decl), FormalParams[FP]);
+        if (FP->isOpenArray ()) {
+            assert (!LoadVal && "An open array has no value");
             return FormalParams[FP];
+        }
+        if (FP->isVar ()) {
+            if (!LoadVal)
+                return FormalParams[FP];
+
+            MemAccess Access;
+            Access.Scope = getAliasScope (Decl);
+            auto* Load = Builder.CreateLoad (CGM.convertType (FP->getType ()), FormalParams[FP]);
+            decorateAccess (Load, FP->getType (), Access);
+            return Load;
         } else
-            return readLocalVariable (BB, Decl);
+            return readLocalVariable (BB, getSlot (Decl));
     }
+    llvm::report_fatal_error ("Access to variables of enclosing procedures is not supported");
 }
 
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - CGProcedure (Read/Write Local Vars)
 /////////////////////////////////////////////////////////////////////////////
 
-void CGProcedure::writeLocalVariable (llvm::BasicBlock* BB, Decl* Decl, llvm::Value* Val) {
+// Locals and value parameters are numbered densely when the procedure is
+// entered. Each block gets a flat table of definitions indexed by that slot,
+// and blocks are numbered in the order they are first seen.
+unsigned CGProcedure::addSlot (Decl* D, llvm::Type* Ty) {
+    unsigned Slot = SlotTypes.size ();
+    VarSlots[D]   = Slot;
+    SlotTypes.push_back (Ty);
+    return Slot;
+}
+
+unsigned CGProcedure::getSlot (Decl* D) {
+    auto It = VarSlots.find (D);
+    assert (It != VarSlots.end () && "Variable has no slot");
+    return It->second;
+}
+
+unsigned CGProcedure::getBlockNumber (llvm::BasicBlock* BB) {
+    auto [It, Inserted] = BlockNumbers.try_emplace (BB, Blocks.size ());
+    if (Inserted) {
+        Blocks.emplace_back ();
+        Blocks.back ().Defs.resize (SlotTypes.size ());
+    }
+    return It->second;
+}
+
+void CGProcedure::writeLocalVariable (llvm::BasicBlock* BB, unsigned Slot, llvm::Value* Val) {
     assert (BB && "Basic block is nullptr");
     assert (Val && "Value is nullptr");
 
-    BasicBlock blockDef = BlockDefs.at (BB);
-    blockDef.Defs[Decl] = llvm::TrackingVH<llvm::Value> (Val);
+    Blocks[getBlockNumber (BB)].Defs[Slot] = Val;
 }
 
 
-llvm::Value* CGProcedure::readLocalVariable (llvm::BasicBlock* BB, Decl* Decl) {
+llvm::Value* CGProcedure::readLocalVariable (llvm::BasicBlock* BB, unsigned Slot) {
     assert (BB && "Basic block is nullptr");
-    BasicBlock blockDef = BlockDefs.at (BB);
-    auto Val            = blockDef.Defs.find (Decl);
-    if (Val != blockDef.Defs.end ())
-        return Val->second;
-    return readLocalVariableRecursive (BB, Decl);
-}
-
-llvm::Value* CGProcedure::readLocalVariableRecursive (llvm::BasicBlock* BB, Decl* Decl) {
-    llvm::Value* Ret   = nullptr;
-    BasicBlock currDef = BlockDefs.at (BB);
-    if (!currDef.Sealed) {
-        llvm::PHINode* Phi = addEmptyPhi (BB, Decl);
-        currDef.IncompletePhis.insert ({ Phi, Decl }); // Add incomplete phi
+    if (llvm::Value* Val = Blocks[getBlockNumber (BB)].Defs[Slot])
+        return Val;
+    return readLocalVariableRecursive (BB, Slot);
+}
+
+llvm::Value* CGProcedure::readLocalVariableRecursive (llvm::BasicBlock* BB, unsigned Slot) {
+    // Blocks may grow while reading the predecessors; only hold the number.
+    unsigned Num     = getBlockNumber (BB);
+    llvm::Value* Ret = nullptr;
+    if (!Blocks[Num].Sealed) {
+        llvm::PHINode* Phi = addEmptyPhi (BB, Slot);
+        Blocks[Num].IncompletePhis.push_back ({ Phi, Slot }); // Add incomplete phi
         Ret = Phi;
     } else if (auto* PredBB = BB->getSinglePredecessor ()) {
         ///// HEADER FILE DOCS /////
@@ -378,16 +1480,16 @@ llvm::Value* CGProcedure::readLocalVariableRecursive (llvm::BasicBlock* BB, Decl
         /// multiple edges from the unique predecessor to this block (for example a
         /// switch statement with multiple cases having the same destination).
         //   const BasicBlock *getUniquePredecessor() const;
-        Ret = readLocalVariable (PredBB, Decl);
+        Ret = readLocalVariable (PredBB, Slot);
     } else { // block is sealed and has multiple preds
         // Create empty phi instruction to break potential
         // cycles.
-        llvm::PHINode* Phi = addEmptyPhi (BB, Decl);
-        writeLocalVariable (BB, Decl, Phi); // Write empty phi to break cycle
-        Ret = addPhiOperands (BB, Decl, Phi); // add pred values as operands to phi
+        llvm::PHINode* Phi = addEmptyPhi (BB, Slot);
+        writeLocalVariable (BB, Slot, Phi); // Write empty phi to break cycle
+        Ret = addPhiOperands (BB, Slot, Phi); // add pred values as operands to phi
     }
 
-    writeLocalVariable (BB, Decl, Ret);
+    writeLocalVariable (BB, Slot, Ret);
     return Ret;
 }
 
@@ -395,16 +1497,16 @@ llvm::Value* CGProcedure::readLocalVariableRecursive (llvm::BasicBlock* BB, Decl
 #pragma mark - CGProcedure (Phi Nodes)
 /////////////////////////////////////////////////////////////////////////////
 
-llvm::PHINode* CGProcedure::addEmptyPhi (llvm::BasicBlock* BB, Decl* Decl) {
+llvm::PHINode* CGProcedure::addEmptyPhi (llvm::BasicBlock* BB, unsigned Slot) {
     return BB->empty () ?
-    llvm::PHINode::Create (mapType (Decl), 0, "", BB) :
-    llvm::PHINode::Create (mapType (Decl), 0, "", &BB->front ());
+    llvm::PHINode::Create (SlotTypes[Slot], 0, "", BB) :
+    llvm::PHINode::Create (SlotTypes[Slot], 0, "", &BB->front ());
 }
 
 llvm::Value*
-CGProcedure::addPhiOperands (llvm::BasicBlock* BB, Decl* Decl, llvm::PHINode* Phi) {
+CGProcedure::addPhiOperands (llvm::BasicBlock* BB, unsigned Slot, llvm::PHINode* Phi) {
     for (auto it = llvm::pred_begin (BB); it != llvm::pred_end (BB); it++)
-        Phi->addIncoming (readLocalVariable (*it, Decl), *it);
+        Phi->addIncoming (readLocalVariable (*it, Slot), *it);
     return optimizePhi (Phi);
 }
 
@@ -465,46 +1567,132 @@ llvm::Value* CGProcedure::optimizePhi (llvm::PHINode* Phi) {
 /////////////////////////////////////////////////////////////////////////////
 
 // To emit a function in LLVM IR, a function type is needed, which is similar to a prototype in C.
+// How aggregates are passed is up to CGABIInfo.
 llvm::FunctionType* CGProcedure::createFunctionType (ProcedureDecl* Proc) {
-    llvm::Type* retType =
-    (!Proc->getRetType ()) ? CGM.VoidTy : mapType (Proc->getRetType ());
-    auto params = Proc->getFormalParams ();
-
-    llvm::SmallVector<llvm::Type*, 8> tmp{};
-    for (auto param : params)
-        tmp.push_back (mapType (param));
-
-    return llvm::FunctionType::get (retType, tmp, false);
+    return CGM.getABIInfo ().getFunctionInfo (Proc).FnTy;
 }
 
 // Based on the function type, we also create the LLVM function.
 // This associates the function type with the linkage and the mangled name:
+// A procedure called before its definition is emitted has been declared
+// already; the definition reuses that function.
 llvm::Function* CGProcedure::createFunction (ProcedureDecl* Proc, llvm::FunctionType* FTy) {
-    auto* func = llvm::Function::Create (
-    FTy, llvm::GlobalValue::ExternalLinkage, "", CGM.getModule ());
+    std::string Name = CGM.mangleName (Proc);
+    if (llvm::Function* Fn = CGM.getModule ()->getFunction (Name))
+        return Fn;
+
+    // Procedures that aren't exported are only called from this module, so
+    // they needn't follow the platform's calling convention. Their linkage
+    // becomes internal once they are defined, see run().
+    auto* func =
+    llvm::Function::Create (FTy, llvm::GlobalValue::ExternalLinkage, Name, CGM.getModule ());
+    if (!Proc->isExported ())
+        func->setCallingConv (llvm::CallingConv::Fast);
+
+    const ABIFunctionInfo& Info = CGM.getABIInfo ().getFunctionInfo (Proc);
+    const llvm::DataLayout& DL  = CGM.getModule ()->getDataLayout ();
+    llvm::Argument* It          = func->arg_begin ();
+    if (Info.Ret.isIndirect ()) {
+        llvm::AttrBuilder Attr (func->getContext ());
+        Attr.addStructRetAttr (Info.Ret.getType ());
+        Attr.addAlignmentAttr (Info.Ret.getAlign ());
+        Attr.addDereferenceableAttr (DL.getTypeStoreSize (Info.Ret.getType ()).getFixedValue ());
+        Attr.addAttribute (llvm::Attribute::NoAlias);
+        Attr.addAttribute (llvm::Attribute::NoCapture);
+        It->addAttrs (Attr);
+        It->setName ("result");
+        ++It;
+    }
 
     // enumerate params
-    size_t idx = 0;
-    for (auto* it = func->arg_begin (); it != func->arg_end (); it++, idx++) {
-        llvm::Argument& Arg     = *it;
-        FormalParameterDecl* FP = Proc->getFormalParams ()[idx];
-
-        // Can Change
-        if (FP->isVar ()) {
-            llvm::AttrBuilder Attr (Function->getContext ());
-            llvm::TypeSize Sz = CGM.getModule ()->getDataLayout ().getTypeStoreSize (
+    for (auto [FP, AI] : llvm::zip (Proc->getFormalParams (), Info.Params)) {
+        llvm::Argument& Arg = *It++;
+
+        // An open array is passed by address, whether VAR or not: Sema keeps
+        // a value open array read-only.
+        if (FP->isOpenArray ()) {
+            TypeDecl* ElemTy = llvm::cast<OpenArrayTypeDecl> (FP->getType ())->getType ();
+            Arg.addAttr (llvm::Attribute::NoCapture);
+            Arg.addAttr (llvm::Attribute::getWithAlignment (
+            func->getContext (), DL.getABITypeAlign (CGM.convertType (ElemTy))));
+            if (!FP->isVar ())
+                Arg.addAttr (llvm::Attribute::ReadOnly);
+            if (isNoAliasOpenArray (Proc, FP))
+                Arg.addAttr (llvm::Attribute::NoAlias);
+            It->setName (FP->getName () + ".len");
+            ++It;
+        } else if (FP->isVar ()) { // Can Change
+            llvm::AttrBuilder Attr (func->getContext ());
+            llvm::TypeSize Sz = DL.getTypeStoreSize (
             CGM.convertType (FP->getType ()));
             Attr.addDereferenceableAttr (Sz);
             Attr.addAttribute (llvm::Attribute::NoCapture);
             Arg.addAttrs (Attr);
+        } else if (AI.isIndirect ()) {
+            llvm::AttrBuilder Attr (func->getContext ());
+            Attr.addByValAttr (AI.getType ());
+            Attr.addAlignmentAttr (AI.getAlign ());
+            Arg.addAttrs (Attr);
         }
 
         Arg.setName (FP->getName ());
     }
 
+    addEffectAttributes (func, Proc->getEffects ());
+    // The procedure writes the sret slot, and may write its byval copies.
+    bool HasIndirect = Info.Ret.isIndirect () ||
+    llvm::any_of (Info.Params, [] (const ABIArgInfo& AI) { return AI.isIndirect (); });
+    if (HasIndirect)
+        func->setMemoryEffects (func->getMemoryEffects () | llvm::MemoryEffects::argMemOnly ());
     return func;
 }
 
+// The address of an open array doesn't alias anything the procedure accesses
+// otherwise if nothing but locals is written while it runs, or if it is the
+// only parameter passed by address and the procedure touches no global memory.
+bool CGProcedure::isNoAliasOpenArray (ProcedureDecl* Proc, FormalParameterDecl* FP) {
+    const ProcedureEffects& E = Proc->getEffects ();
+    if (!E.Computed)
+        return false;
+    if (!(E.ArgMem & ProcedureEffects::MR_Mod) && !(E.Globals & ProcedureEffects::MR_Mod))
+        return true;
+
+    bool OnlyByAddress = llvm::none_of (Proc->getFormalParams (), [FP] (FormalParameterDecl* Other) {
+        return Other != FP && (Other->isVar () || Other->isOpenArray ());
+    });
+    return OnlyByAddress && E.Globals == ProcedureEffects::MR_None;
+}
+
+// Translates the summary computed by Sema's EffectAnalysis into function
+// attributes, so the optimizer can hoist, CSE and delete calls.
+void CGProcedure::addEffectAttributes (llvm::Function* Fn, const ProcedureEffects& Effects) {
+    if (!Effects.Computed)
+        return;
+
+    // ProcedureEffects::ModRef uses the same encoding as llvm::ModRefInfo.
+    auto ArgMR    = static_cast<llvm::ModRefInfo> (Effects.ArgMem);
+    auto GlobalMR = static_cast<llvm::ModRefInfo> (Effects.Globals);
+    Fn->setMemoryEffects (llvm::MemoryEffects::argMemOnly (ArgMR) |
+    llvm::MemoryEffects (llvm::IRMemLocation::Other, GlobalMR));
+
+    if (!Effects.MayUnwind)
+        Fn->setDoesNotThrow ();
+    // A failed runtime check ends in the runtime's reporter, which writes to
+    // stderr and doesn't return. Only the CASE check is emitted without
+    // -fbounds-check or -fdiv-check.
+    bool MayFailCheck = (Effects.MayFailCheck && (BoundsCheck || DivCheck)) || Effects.MayTrap;
+    // So does the runtime's heap behind NEW and DISPOSE, and so do RAISE and
+    // the landing pads of TRY, which allocate, throw and catch the exception
+    // object through the C++ runtime. A landing pad only exists where a call
+    // may unwind, which makes the procedure MayUnwind as well.
+    if (MayFailCheck || Effects.MayAllocate || Effects.MayUnwind)
+        Fn->setMemoryEffects (Fn->getMemoryEffects () | llvm::MemoryEffects::inaccessibleMemOnly ());
+    if (!Effects.MayNotReturn && !MayFailCheck)
+        Fn->addFnAttr (llvm::Attribute::WillReturn);
+    if (!Effects.MayRecurse)
+        Fn->setDoesNotRecurse ();
+}
+
 
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - CGProcedure (Utils)
@@ -520,23 +1708,59 @@ llvm::Function* CGProcedure::createFunction (ProcedureDecl* Proc, llvm::Function
  * @param BB The basic block to seal.
  */
 void CGProcedure::sealBlock (llvm::BasicBlock* BB) {
-
-    auto it = BlockDefs.find (BB);
-    if (it != BlockDefs.end ()) {
-        for (auto PhiDecl : it->second.IncompletePhis) {
-            addPhiOperands (BB, PhiDecl.second, PhiDecl.first);
-        }
-        it->second.IncompletePhis.clear ();
-        it->second.Sealed = true;
+    // Reading the predecessors may add new blocks, so the incomplete phis
+    // are taken out of the table first.
+    unsigned Num        = getBlockNumber (BB);
+    auto IncompletePhis = std::move (Blocks[Num].IncompletePhis);
+    for (auto [Phi, Slot] : IncompletePhis) {
+        addPhiOperands (BB, Slot, Phi);
     }
+    Blocks[Num].IncompletePhis.clear ();
+    Blocks[Num].Sealed = true;
 }
 
 
+bool CGProcedure::isInMemory (Decl* D) {
+    if (Addresses.count (D) || llvm::isa<ConstantDecl> (D))
+        return true;
+    if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (D))
+        return FP->isVar () || FP->isOpenArray ();
+    return D->getEnclosingDecl () != ProcDecl;
+}
+
+// Locals are not visible to anybody else, and heap memory is left unscoped.
+std::optional<CGModule::AliasScopeKind> CGProcedure::getAliasScope (Decl* D) {
+    if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (D); FP && (FP->isVar () || FP->isOpenArray ()))
+        return CGModule::AS_VarParams;
+    if (auto* V = llvm::dyn_cast<VariableDecl> (D))
+        if (V->getEnclosingDecl () == CGM.getModuleDeclaration () && !V->isAddressTaken ())
+            return CGModule::AS_Globals;
+    return std::nullopt;
+}
+
+void CGProcedure::decorateAccess (llvm::Instruction* Inst, TypeDecl* Ty, const MemAccess& Access) {
+    CGM.decorateInst (Inst, Ty, Access.Base, Access.Offset);
+    if (Access.Scope)
+        CGM.addAliasScope (Inst, *Access.Scope);
+}
+
+TypeDecl* CGProcedure::getDeclType (Decl* D) {
+    if (auto* V = llvm::dyn_cast<VariableDecl> (D))
+        return V->getType ();
+    if (auto* C = llvm::dyn_cast<ConstantDecl> (D))
+        return C->getExpr ()->getType ();
+    return llvm::cast<FormalParameterDecl> (D)->getType ();
+}
+
 llvm::Type* CGProcedure::mapType (Decl* Decl) {
     if (auto* V = llvm::dyn_cast<VariableDecl> (Decl))
         return CGM.convertType (V->getType ());
+    if (auto* C = llvm::dyn_cast<ConstantDecl> (Decl))
+        return CGM.convertType (C->getExpr ()->getType ());
 
     if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Decl)) {
+        if (FP->isOpenArray ())
+            return CGM.PtrTy;
         llvm::Type* Ty = CGM.convertType (FP->getType ());
         if (FP->isVar ())
             Ty = Ty->getPointerTo ();
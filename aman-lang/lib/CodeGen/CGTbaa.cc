@@ -23,23 +23,27 @@ llvm::MDNode* CGTbaa::getTypeInfo (TypeDecl* Ty) {
     if (llvm::MDNode* N = MetadataCache[Ty])
         return N;
 
-    // First check if Pervasive (Built-In) Scalar Type
+    // First check if Pervasive (Built-In) Scalar Type. Every integer width
+    // is a type of its own, which only a VAR parameter of that type can alias.
     if (auto* Pervasive = llvm::dyn_cast<PervasiveTypeDecl> (Ty)) {
         StringRef Name = Pervasive->getName ();
         return createScalarTypeNode (Pervasive, Name, getRoot ());
     }
 
+    // Aliases share the node of the type they name
+    if (auto* Alias = llvm::dyn_cast<AliasTypeDecl> (Ty))
+        return MetadataCache[Ty] = getTypeInfo (Alias->getType ());
+
     // Check if its a Pointer (boils down to a (char, 0) aka scalar node)
     if (auto* Pointer = llvm::dyn_cast<PointerTypeDecl> (Ty)) {
         StringRef Name = "any pointer";
         return createScalarTypeNode (Pointer, Name, getRoot ());
     }
 
-    // Check if its an array (Boils down to a bunch of members with simillar type and offsets)
-    if (auto* Array = llvm::dyn_cast<ArrayTypeDecl> (Ty)) {
-        StringRef Name = Array->getType ()->getName ();
-        return createScalarTypeNode (Array, Name, getRoot ());
-    }
+    // An array access is always an access to one of its elements, so an
+    // array is described by the node of its element type.
+    if (auto* Array = llvm::dyn_cast<ArrayTypeDecl> (Ty))
+        return MetadataCache[Ty] = getTypeInfo (Array->getType ());
 
     // Here comes the hard part
     // For records there might be different types which = diff offsets
@@ -51,11 +55,14 @@ llvm::MDNode* CGTbaa::getTypeInfo (TypeDecl* Ty) {
 
         unsigned Idx = 0;
         for (const auto& F : Record->getFields ()) {
-            uint64_t Offset = Layout->getElementOffset (Idx);
+            uint64_t Offset = Layout->getElementOffset (CGM.getFieldIndex (Record, Idx));
             Fields.emplace_back (getTypeInfo (F.getType ()), Offset);
             ++Idx;
         }
-        StringRef Name = CGM.mangleName (Record);
+        // -freorder-record-fields lays fields out apart from declaration
+        // order, but the offsets of a struct type node must be ascending.
+        llvm::sort (Fields, [] (const auto& A, const auto& B) { return A.second < B.second; });
+        std::string Name = CGM.mangleName (Record);
         return createStructTypeNode (Record, Name, Fields);
     }
 
@@ -63,8 +70,18 @@ llvm::MDNode* CGTbaa::getTypeInfo (TypeDecl* Ty) {
     return nullptr;
 }
 
-llvm::MDNode* CGTbaa::getAccessTagInfo (TypeDecl* Ty) {
-    return getTypeInfo (Ty);
+llvm::MDNode* CGTbaa::getAccessTagInfo (TypeDecl* Ty, TypeDecl* Base, uint64_t Offset) {
+    while (auto* Alias = llvm::dyn_cast<AliasTypeDecl> (Ty))
+        Ty = Alias->getType ();
+
+    // Loads and stores of whole arrays and records get no tag.
+    if (!llvm::isa<PervasiveTypeDecl, PointerTypeDecl> (Ty))
+        return nullptr;
+
+    llvm::MDNode* Access = getTypeInfo (Ty);
+    if (!Base)
+        return Builder.createTBAAStructTagNode (Access, Access, 0);
+    return Builder.createTBAAStructTagNode (getTypeInfo (Base), Access, Offset);
 }
 
 
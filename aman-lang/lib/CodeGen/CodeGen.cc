@@ -1,9 +1,48 @@
 #include "amanlang/CodeGen/CodeGen.h"
 #include "amanlang/CodeGen/CGModule.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 #include <memory>
+#include <vector>
 
 namespace amanlang {
 
+static llvm::cl::opt<unsigned> IRGenThreads ("irgen-threads",
+llvm::cl::desc ("Generate the IR of procedures in batches on N threads"),
+llvm::cl::init (1));
+
+static llvm::cl::opt<unsigned> IRGenBatchSize ("irgen-batch-size",
+llvm::cl::desc ("Number of procedures per partial module with -irgen-threads"),
+llvm::cl::init (64));
+
+static std::unique_ptr<llvm::Module>
+createModule (llvm::LLVMContext& Ctx, llvm::StringRef Name, llvm::TargetMachine& Machine) {
+    auto M = std::make_unique<llvm::Module> (Name, Ctx);
+
+    M->setTargetTriple (Machine.getTargetTriple ().getTriple ());
+    M->setDataLayout (Machine.createDataLayout ());
+    return M;
+}
+
+// Symbols with local linkage don't resolve across modules. They are made
+// external while linking, and the original linkage is remembered by name.
+static void
+externalizeLocals (llvm::Module& M, llvm::StringMap<llvm::GlobalValue::LinkageTypes>& Linkage) {
+    for (llvm::GlobalValue& GV : M.global_values ()) {
+        if (GV.hasLocalLinkage () && GV.hasName ()) {
+            Linkage[GV.getName ()] = GV.getLinkage ();
+            GV.setLinkage (llvm::GlobalValue::ExternalLinkage);
+        }
+    }
+}
+
 /// A Module instance is used to store all the information related to an
 /// LLVM module. Modules are the top level container of all other LLVM
 /// Intermediate Representation (IR) objects. Each module directly contains a
@@ -11,15 +50,86 @@ namespace amanlang {
 /// other modules) this module depends on, a symbol table, and various data
 /// about the target's characteristics.
 std::unique_ptr<llvm::Module> CodeGen::run (ModuleDecl* Decl, std::string name) {
-    auto M = std::make_unique<llvm::Module> (name, Ctx);
-
-    M->setTargetTriple (Machine.getTargetTriple ().getTriple ());
-    M->setDataLayout (Machine.createDataLayout ());
+    auto M = createModule (Ctx, name, Machine);
 
     CGModule CGM (M.get (), ASTCtx);
     CGM.initialize ();
-    CGM.run (Decl);
+    // Debug info has a single compile unit and scope stack per module, so
+    // it is generated serially. Once given, -irgen-threads takes the batched
+    // path for any N, even 1, so the IR is the same for every thread count.
+    if (!IRGenThreads.getNumOccurrences () || CGM.getDbgInfo ()) {
+        CGM.run (Decl);
+        return M;
+    }
+
+    CGM.emitGlobals (Decl);
+    emitProceduresParallel (Decl, *M);
     return M;
 }
 
+// Generates the procedures in batches on worker threads. Each batch gets its
+// own LLVMContext and module, which only declares the globals; the AST is
+// shared and only read. The batches are handed back as bitcode and linked in
+// declaration order, so the result doesn't depend on the number of threads.
+void CodeGen::emitProceduresParallel (ModuleDecl* Decl, llvm::Module& M) {
+    std::vector<std::vector<ProcedureDecl*>> Batches;
+    for (auto* D : Decl->getDecls ()) {
+        if (auto* Proc = llvm::dyn_cast<ProcedureDecl> (D)) {
+            if (Batches.empty () || Batches.back ().size () >= IRGenBatchSize)
+                Batches.emplace_back ();
+            Batches.back ().push_back (Proc);
+        }
+    }
+
+    // SourceMgr builds the line table of a buffer on the first lookup, which
+    // the runtime checks of the workers do (see getCheckSite). Building it
+    // here, before the workers start, leaves them reading only.
+    const llvm::SourceMgr& SrcMgr = ASTCtx.getSourceMgr ();
+    for (unsigned ID = 1, E = SrcMgr.getNumBuffers (); ID <= E; ++ID) {
+        const llvm::MemoryBuffer* Buffer = SrcMgr.getMemoryBuffer (ID);
+        SrcMgr.FindLineNumber (llvm::SMLoc::getFromPointer (Buffer->getBufferEnd ()), ID);
+    }
+
+    std::vector<llvm::SmallVector<char, 0>> Bitcode (Batches.size ());
+    {
+        llvm::DefaultThreadPool Pool (llvm::hardware_concurrency (IRGenThreads));
+        for (size_t I = 0, E = Batches.size (); I != E; ++I) {
+            Pool.async ([&, I] {
+                llvm::LLVMContext BatchCtx;
+                auto BatchM = createModule (BatchCtx, M.getName (), Machine);
+
+                CGModule CGM (BatchM.get (), ASTCtx);
+                CGM.emitGlobals (Decl, false);
+                for (auto* Proc : Batches[I])
+                    CGM.emitProcedure (Proc);
+
+                llvm::raw_svector_ostream OS (Bitcode[I]);
+                llvm::WriteBitcodeToFile (*BatchM, OS);
+            });
+        }
+        Pool.wait ();
+    }
+
+    llvm::StringMap<llvm::GlobalValue::LinkageTypes> Linkage;
+    externalizeLocals (M, Linkage);
+
+    llvm::Linker L (M);
+    for (auto& Buffer : Bitcode) {
+        llvm::MemoryBufferRef Ref (llvm::StringRef (Buffer.data (), Buffer.size ()), M.getName ());
+        auto Part = llvm::parseBitcodeFile (Ref, M.getContext ());
+        if (!Part)
+            llvm::report_fatal_error (Part.takeError ());
+
+        externalizeLocals (**Part, Linkage);
+        if (L.linkInModule (std::move (*Part)))
+            llvm::report_fatal_error ("Linking generated procedures failed");
+    }
+
+    for (llvm::GlobalValue& GV : M.global_values ()) {
+        auto It = Linkage.find (GV.getName ());
+        if (It != Linkage.end ())
+            GV.setLinkage (It->second);
+    }
+}
+
 } // namespace amanlang
@@ -88,6 +88,21 @@ void Lexer::number (Token& Result) {
         Kind = tok::integer_literal;
         ++End;
         break;
+    case '.': /* real number, unless a range `1..9` follows */
+        if (!IsHex && End[1] != '.') {
+            Kind = tok::real_literal;
+            ++End;
+            while (charinfo::isDigit (*End))
+                ++End;
+            if (*End == 'E' && (charinfo::isDigit (End[1]) ||
+                               ((End[1] == '+' || End[1] == '-') && charinfo::isDigit (End[2])))) {
+                End += 2;
+                while (charinfo::isDigit (*End))
+                    ++End;
+            }
+            break;
+        }
+        [[fallthrough]];
     default: /* decimal number */
         if (IsHex)
             Diag.report (getLoc (), diag::err_hex_digit_in_decimal);
@@ -160,7 +175,12 @@ void Lexer::next (Token& Result) {
         case '*': formToken (Result, Ptr + 1, tok::star); break;
         case '/': formToken (Result, Ptr + 1, tok::slash); break;
         case ',': formToken (Result, Ptr + 1, tok::comma); break;
-        case '.': formToken (Result, Ptr + 1, tok::period); break;
+        case '.':
+            if (*(Ptr + 1) == '.')
+                formToken (Result, Ptr + 2, tok::ellipsis);
+            else
+                formToken (Result, Ptr + 1, tok::period);
+            break;
         case ';': formToken (Result, Ptr + 1, tok::semi); break;
         case ')': formToken (Result, Ptr + 1, tok::r_paren); break;
         case '(':
@@ -190,9 +210,16 @@ void Lexer::next (Token& Result) {
             break;
 
         // CH.5 (selectors)
-        case '^': formToken (Result, Ptr + 1, tok::caret);
-        case '[': formToken (Result, Ptr + 1, tok::l_square);
-        case ']': formToken (Result, Ptr + 1, tok::r_square);
+        case '^': formToken (Result, Ptr + 1, tok::caret); break;
+        case '[': formToken (Result, Ptr + 1, tok::l_square); break;
+        case ']': formToken (Result, Ptr + 1, tok::r_square); break;
+
+        // Structured constants
+        case '{': formToken (Result, Ptr + 1, tok::l_brace); break;
+        case '}': formToken (Result, Ptr + 1, tok::r_brace); break;
+
+        // Separates the handlers of a TRY statement
+        case '|': formToken (Result, Ptr + 1, tok::pipe); break;
 
         default: Result.setKind (tok::unknown);
         }
@@ -123,7 +123,7 @@ bool Parser::parseBlock (DeclList& Decls, StmtList& Stmts) {
     auto handle_err = [this] () { return skipUntil (tok::identifier); };
     llvm::outs () << "parseBlock\n";
 
-    while (Tok.isOneOf (tok::kw_CONST, tok::kw_PROCEDURE, tok::kw_VAR, tok::kw_TYPE))
+    while (Tok.isOneOf (tok::kw_CONST, tok::kw_PROCEDURE, tok::kw_VAR, tok::kw_TYPE, tok::kw_EXCEPTION))
         if (!parseDeclaration (Decls))
             return handle_err ();
 
@@ -193,7 +193,7 @@ bool Parser::parseTypeDeclaration (DeclList& Decls) {
             return _errorhandler ();
         Decl* D;
         advance ();
-        if (parseQualident (D))
+        if (!parseQualident (D))
             return _errorhandler ();
         Actions.actOnArrayTypeDeclaration (Decls, Loc, Name, E, D);
     } else if (Tok.is (tok::kw_RECORD)) {
@@ -292,7 +292,7 @@ bool Parser::parseSelectors (Expr*& E) {
 bool Parser::parseDeclaration (DeclList& Decls) {
     auto handle_err = [this] () {
         return skipUntil (tok::kw_BEGIN, tok::kw_CONST, tok::kw_END,
-        tok::kw_PROCEDURE, tok::kw_VAR);
+        tok::kw_PROCEDURE, tok::kw_VAR, tok::kw_EXCEPTION);
     };
 
     switch (Tok.getKind ()) {
@@ -308,6 +308,12 @@ bool Parser::parseDeclaration (DeclList& Decls) {
             if (!parseVariableDeclaration (Decls) || !consume (tok::semi))
                 return handle_err ();
         break;
+    case tok::kw_EXCEPTION:
+        advance ();
+        while (Tok.is (tok::identifier))
+            if (!parseExceptionDeclaration (Decls) || !consume (tok::semi))
+                return handle_err ();
+        break;
     case tok::kw_PROCEDURE:
         return (!parseProcedureDeclaration (Decls) || !consume (tok::semi)) ?
         handle_err () :
@@ -374,6 +380,25 @@ bool Parser::parseVariableDeclaration (DeclList& Decls) {
     return true;
 }
 
+/**
+ * Parses an exception declaration in the current scope.
+ *
+ * @param Decls The list of declarations to add the declared exceptions to.
+ * @return `true` if the exception declaration was parsed successfully, `false` otherwise.
+ * @example `EXCEPTION NotFound, Overflow;`
+ */
+bool Parser::parseExceptionDeclaration (DeclList& Decls) {
+    auto handle_err = [this] () { return skipUntil (tok::semi); };
+    IdentList Ids;
+
+    if (!parseIdentList (Ids))
+        return handle_err ();
+
+    // Check Semantics
+    Actions.actOnExceptionDeclaration (Decls, Ids);
+    return true;
+}
+
 /**
  * Parses a procedure declaration in the input stream.
  *
@@ -401,6 +426,12 @@ bool Parser::parseProcedureDeclaration (DeclList& ParentDecls) {
     Decl* RetType = nullptr;
     advance ();
 
+    // Export mark
+    if (Tok.is (tok::star)) {
+        Actions.actOnExportMark (D, Tok.getLocation ());
+        advance ();
+    }
+
     // Parameters
     if (Tok.is (tok::l_paren))
         if (!parseFormalParameters (Params, RetType))
@@ -490,11 +521,13 @@ bool Parser::parseFormalParameterList (FormalParamList& Params) {
  *
  * This function is responsible for parsing a formal parameter declaration, which
  * can include a variable parameter (prefixed with 'var') and a type
- * specification. The parsed parameter is added to the provided `FormalParamList`.
+ * specification. The type may be an open array, `ARRAY OF` a named type. The
+ * parsed parameter is added to the provided `FormalParamList`.
  *
  * @param Params The formal parameter list to add the parsed parameter to.
  * @return `true` if the parameter was parsed successfully, `false` otherwise.
  * @example formal parameter list: `var x, y: integer`
+ * @example open array parameter: `a: ARRAY OF INTEGER`
  */
 bool Parser::parseFormalParameter (FormalParamList& Params) {
     auto handle_err = [this] () { return skipUntil (tok::r_paren, tok::semi); };
@@ -508,8 +541,18 @@ bool Parser::parseFormalParameter (FormalParamList& Params) {
         advance ();
     }
 
-    if (!parseIdentList (Ids) || !consume (tok::colon) || !parseQualident (D))
+    if (!parseIdentList (Ids) || !consume (tok::colon))
+        return handle_err ();
+
+    if (Tok.is (tok::kw_ARRAY)) {
+        auto Loc = Tok.getLocation ();
+        advance ();
+        if (!consume (tok::kw_OF) || !parseQualident (D))
+            return handle_err ();
+        D = Actions.actOnOpenArrayType (Loc, D);
+    } else if (!parseQualident (D)) {
         return handle_err ();
+    }
 
     // Check Semantics + (Add to Params)
     Actions.actOnFormalParameterDeclaration (Params, Ids, D, IsVar);
@@ -533,7 +576,9 @@ bool Parser::parseFormalParameter (FormalParamList& Params) {
  * @return `true` if the statement sequence was parsed successfully, `false` otherwise.
  */
 bool Parser::parseStatementSequence (StmtList& Stmts) {
-    auto handle_err = [this] () { return skipUntil (tok::kw_ELSE, tok::kw_END); };
+    auto handle_err = [this] () {
+        return skipUntil (tok::kw_ELSE, tok::kw_END, tok::kw_EXCEPT, tok::pipe);
+    };
     if (!parseStatement (Stmts))
         return handle_err ();
     while (Tok.is (tok::semi)) {
@@ -557,7 +602,7 @@ bool Parser::parseStatementSequence (StmtList& Stmts) {
  */
 bool Parser::parseStatement (StmtList& Stmts) {
     auto handle_err = [this] () {
-        return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END);
+        return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END, tok::kw_EXCEPT, tok::pipe);
     };
 
 
@@ -583,11 +628,11 @@ bool Parser::parseStatement (StmtList& Stmts) {
             if (Tok.is (tok::l_paren)) {
                 advance ();
                 if (Tok.isOneOf (tok::l_paren, tok::plus, tok::minus,
-                    tok::kw_NOT, tok::identifier, tok::integer_literal)) {
+                    tok::kw_NOT, tok::identifier, tok::integer_literal, tok::real_literal)) {
                     if (!parseExprList (Exprs))
                         return handle_err ();
                 }
-                if (consume (tok::r_paren))
+                if (!consume (tok::r_paren))
                     return handle_err ();
             }
             Actions.actOnProcCall (Stmts, Loc, D, Exprs);
@@ -600,14 +645,30 @@ bool Parser::parseStatement (StmtList& Stmts) {
         if (!parseIfStatement (Stmts))
             return handle_err ();
         break;
+    case tok::kw_CASE:
+        if (!parseCaseStatement (Stmts))
+            return handle_err ();
+        break;
     case tok::kw_WHILE:
         if (!parseWhileStatement (Stmts))
             return handle_err ();
         break;
+    case tok::kw_FOR:
+        if (!parseForStatement (Stmts))
+            return handle_err ();
+        break;
     case tok::kw_RETURN:
         if (!parseReturnStatement (Stmts))
             return handle_err ();
         break;
+    case tok::kw_RAISE:
+        if (!parseRaiseStatement (Stmts))
+            return handle_err ();
+        break;
+    case tok::kw_TRY:
+        if (!parseTryStatement (Stmts))
+            return handle_err ();
+        break;
     default: return handle_err ();
     }
 
@@ -651,6 +712,93 @@ bool Parser::parseIfStatement (StmtList& Stmts) {
     return false;
 }
 
+/**
+ * Parses a case statement in the input stream.
+ *
+ * Like the header of a FOR statement, the selector is handed to Sema before
+ * the alternatives are parsed, so that each label can be checked against its
+ * type. The alternatives are separated by `|` and may be empty.
+ *
+ * @param Stmts The statement list to add the parsed case statement to.
+ * @return `true` if the case statement was parsed successfully, `false` otherwise.
+ * @example `CASE op OF 0: Push (x) | 1, 2: Pop | 10 .. 19: Jump (op - 10) ELSE Halt END`
+ */
+bool Parser::parseCaseStatement (StmtList& Stmts) {
+    auto handle_err = [this] () {
+        return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END);
+    };
+    Expr* E = nullptr;
+    StmtList ElseStmts;
+    bool HasElse    = false;
+    llvm::SMLoc Loc = Tok.getLocation ();
+
+    if (!consume (tok::kw_CASE) || !parseExpression (E) || !consume (tok::kw_OF))
+        return handle_err ();
+
+    CaseStatement* Case = Actions.actOnCaseStatement (Loc, E);
+    if (!Tok.isOneOf (tok::pipe, tok::kw_ELSE, tok::kw_END) && !parseCase (Case))
+        return handle_err ();
+    while (Tok.is (tok::pipe)) {
+        advance ();
+        if (!Tok.isOneOf (tok::pipe, tok::kw_ELSE, tok::kw_END) && !parseCase (Case))
+            return handle_err ();
+    }
+
+    if (Tok.is (tok::kw_ELSE)) {
+        advance ();
+        HasElse = true;
+        if (!parseStatementSequence (ElseStmts))
+            return handle_err ();
+    }
+
+    if (!expect (tok::kw_END))
+        return handle_err ();
+
+    // Check Semantics + (Add to Stmts)
+    Actions.actOnCaseStatement (Stmts, Case, ElseStmts, HasElse);
+    advance ();
+    return true;
+}
+
+bool Parser::parseCase (CaseStatement* Case) {
+    auto handle_err = [this] () {
+        return skipUntil (tok::pipe, tok::kw_ELSE, tok::kw_END);
+    };
+    CaseLabelList Labels;
+    StmtList CaseStmts;
+
+    if (!parseCaseLabel (Case, Labels))
+        return handle_err ();
+    while (Tok.is (tok::comma)) {
+        advance ();
+        if (!parseCaseLabel (Case, Labels))
+            return handle_err ();
+    }
+    if (!consume (tok::colon) || !parseStatementSequence (CaseStmts))
+        return handle_err ();
+
+    // Check Semantics + (Add to Case)
+    Actions.actOnCase (Case, Labels, CaseStmts);
+    return true;
+}
+
+bool Parser::parseCaseLabel (CaseStatement* Case, CaseLabelList& Labels) {
+    Expr* Low       = nullptr;
+    Expr* High      = nullptr;
+    llvm::SMLoc Loc = Tok.getLocation ();
+
+    if (!parseExpression (Low))
+        return false;
+    if (Tok.is (tok::ellipsis)) {
+        advance ();
+        if (!parseExpression (High))
+            return false;
+    }
+
+    Actions.actOnCaseLabel (Case, Labels, Loc, Low, High);
+    return true;
+}
+
 /**
  * Parses a while statement in the input stream.
  *
@@ -679,6 +827,49 @@ bool Parser::parseWhileStatement (StmtList& Stmts) {
     return true;
 }
 
+/**
+ * Parses a for statement in the input stream.
+ *
+ * The header is handed to Sema before the body is parsed, so that Sema can
+ * reject assignments to the control variable inside the body.
+ *
+ * @param Stmts The statement list to add the parsed for statement to.
+ * @return `true` if the for statement was parsed successfully, `false` otherwise.
+ * @example `FOR i := 1 TO 10 BY 2 DO ... END`
+ */
+bool Parser::parseForStatement (StmtList& Stmts) {
+    auto handle_err = [this] () {
+        return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END);
+    };
+    Decl* D     = nullptr;
+    Expr* Start = nullptr;
+    Expr* End   = nullptr;
+    Expr* Step  = nullptr;
+    StmtList ForStmts;
+    llvm::SMLoc Loc = Tok.getLocation ();
+
+    if (!consume (tok::kw_FOR) || !parseQualident (D) || !consume (tok::colonequal) ||
+    !parseExpression (Start) || !consume (tok::kw_TO) || !parseExpression (End))
+        return handle_err ();
+    if (Tok.is (tok::kw_BY)) {
+        advance ();
+        if (!parseExpression (Step))
+            return handle_err ();
+    }
+    if (!consume (tok::kw_DO))
+        return handle_err ();
+
+    // Check Semantics of the header, then of the body
+    ForStatement* For = Actions.actOnForStatement (Loc, D, Start, End, Step);
+    bool BodyOk       = parseStatementSequence (ForStmts) && expect (tok::kw_END);
+    Actions.actOnForStatement (Stmts, For, ForStmts);
+    if (!BodyOk)
+        return handle_err ();
+
+    advance ();
+    return true;
+}
+
 bool Parser::parseReturnStatement (StmtList& Stmts) {
     auto handle_err = [this] () {
         return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END);
@@ -689,7 +880,7 @@ bool Parser::parseReturnStatement (StmtList& Stmts) {
     if (!consume (tok::kw_RETURN))
         return handle_err ();
     if (Tok.isOneOf (tok::l_paren, tok::plus, tok::minus, tok::kw_NOT,
-        tok::identifier, tok::integer_literal))
+        tok::identifier, tok::integer_literal, tok::real_literal))
         if (!parseExpression (E))
             return handle_err ();
 
@@ -698,6 +889,90 @@ bool Parser::parseReturnStatement (StmtList& Stmts) {
     return true;
 }
 
+/**
+ * Parses a raise statement in the input stream.
+ *
+ * @param Stmts The statement list to add the parsed raise statement to.
+ * @return `true` if the raise statement was parsed successfully, `false` otherwise.
+ * @example `RAISE NotFound`
+ */
+bool Parser::parseRaiseStatement (StmtList& Stmts) {
+    auto handle_err = [this] () {
+        return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END);
+    };
+    Decl* D         = nullptr;
+    llvm::SMLoc Loc = Tok.getLocation ();
+
+    if (!consume (tok::kw_RAISE) || !parseQualident (D))
+        return handle_err ();
+
+    // Check Semantics + (Add to Stmts)
+    Actions.actOnRaiseStatement (Stmts, Loc, D);
+    return true;
+}
+
+/**
+ * Parses a try statement in the input stream.
+ *
+ * The handlers follow EXCEPT and are separated by `|`, like the cases of a
+ * CASE statement. An ELSE part handles all remaining exceptions.
+ *
+ * @param Stmts The statement list to add the parsed try statement to.
+ * @return `true` if the try statement was parsed successfully, `false` otherwise.
+ * @example `TRY Find (x) EXCEPT NotFound: x := 0 | Overflow: x := -1 ELSE x := -2 END`
+ */
+bool Parser::parseTryStatement (StmtList& Stmts) {
+    auto handle_err = [this] () {
+        return skipUntil (tok::semi, tok::kw_ELSE, tok::kw_END);
+    };
+    StmtList TryStmts, ElseStmts;
+    HandlerList Handlers;
+    bool HasElse    = false;
+    llvm::SMLoc Loc = Tok.getLocation ();
+
+    if (!consume (tok::kw_TRY) || !parseStatementSequence (TryStmts) || !consume (tok::kw_EXCEPT))
+        return handle_err ();
+
+    if (Tok.is (tok::identifier) && !parseExceptHandler (Handlers))
+        return handle_err ();
+    while (Tok.is (tok::pipe)) {
+        advance ();
+        if (!parseExceptHandler (Handlers))
+            return handle_err ();
+    }
+
+    if (Tok.is (tok::kw_ELSE)) {
+        advance ();
+        HasElse = true;
+        if (!parseStatementSequence (ElseStmts))
+            return handle_err ();
+    }
+
+    if (!expect (tok::kw_END))
+        return handle_err ();
+
+    // Check Semantics + (Add to Stmts)
+    Actions.actOnTryStatement (Stmts, Loc, TryStmts, Handlers, ElseStmts, HasElse);
+    advance ();
+    return true;
+}
+
+bool Parser::parseExceptHandler (HandlerList& Handlers) {
+    auto handle_err = [this] () {
+        return skipUntil (tok::pipe, tok::kw_ELSE, tok::kw_END);
+    };
+    Decl* D         = nullptr;
+    StmtList HandlerStmts;
+    llvm::SMLoc Loc = Tok.getLocation ();
+
+    if (!parseQualident (D) || !consume (tok::colon) || !parseStatementSequence (HandlerStmts))
+        return handle_err ();
+
+    // Check Semantics + (Add to Handlers)
+    Actions.actOnExceptHandler (Handlers, Loc, D, HandlerStmts);
+    return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - Parser (Expressions)
 /////////////////////////////////////////////////////////////////////////////
@@ -780,7 +1055,7 @@ bool Parser::parseExpression (Expr*& E) {
 bool Parser::parseRelation (OperatorInfo& Op) {
     auto handle_err = [this] () {
         return skipUntil (tok::l_paren, tok::plus, tok::minus, tok::kw_NOT,
-        tok::identifier, tok::integer_literal);
+        tok::identifier, tok::integer_literal, tok::real_literal);
     };
 
     if (Tok.isOneOf (tok::equal, tok::hash, tok::less, tok::lessequal,
@@ -851,7 +1126,7 @@ bool Parser::parseSimpleExpression (Expr*& E) {
  */
 bool Parser::parseAddOperator (OperatorInfo& Op) {
     auto handle_err = [this] () {
-        return skipUntil (tok::l_paren, tok::kw_NOT, tok::identifier, tok::integer_literal);
+        return skipUntil (tok::l_paren, tok::kw_NOT, tok::identifier, tok::integer_literal, tok::real_literal);
     };
     if (Tok.isOneOf (tok::plus, tok::minus, tok::kw_OR)) {
         Op = fromTok (Tok);
@@ -875,7 +1150,7 @@ bool Parser::parseAddOperator (OperatorInfo& Op) {
  */
 bool Parser::parseMulOperator (OperatorInfo& Op) {
     auto handle_err = [this] () {
-        return skipUntil (tok::l_paren, tok::kw_NOT, tok::identifier, tok::integer_literal);
+        return skipUntil (tok::l_paren, tok::kw_NOT, tok::identifier, tok::integer_literal, tok::real_literal);
     };
     if (Tok.isOneOf (tok::star, tok::slash, tok::kw_DIV, tok::kw_MOD, tok::kw_AND)) {
         Op = fromTok (Tok);
@@ -918,7 +1193,7 @@ bool Parser::parseFactor (Expr*& E) {
         if (Tok.is (tok::l_paren)) {
             advance ();
             if (Tok.isOneOf (tok::l_paren, tok::plus, tok::minus, tok::kw_NOT,
-                tok::identifier, tok::integer_literal))
+                tok::identifier, tok::integer_literal, tok::real_literal))
                 if (!parseExprList (Exprs))
                     return handle_err ();
 
@@ -927,16 +1202,44 @@ bool Parser::parseFactor (Expr*& E) {
 
             E = Actions.actOnFunctionCall (D, Exprs);
             advance ();
-        } else if (Tok.isOneOf (tok::hash, tok::r_paren, tok::star, tok::plus,
-                   tok::comma, tok::minus, tok::slash, tok::semi, tok::less,
-                   tok::lessequal, tok::equal, tok::greater, tok::greaterequal,
-                   tok::kw_AND, tok::kw_DIV, tok::kw_DO, tok::kw_ELSE,
-                   tok::kw_END, tok::kw_MOD, tok::kw_OR, tok::kw_THEN)) {
+        } else if (Tok.is (tok::l_brace)) {
+            llvm::SMLoc Loc = Tok.getLocation ();
+            if (!parseAggregate (Exprs))
+                return handle_err ();
+            E = Actions.actOnAggregate (Loc, D, Exprs);
+        } else {
             E = Actions.actOnDesignator (D);
+            if (!parseSelectors (E))
+                return handle_err ();
         }
         break;
     }
 
+    case tok::integer_literal:
+        E = Actions.actOnIntegerLiteral (Tok.getLocation (), Tok.getIdentifier ());
+        advance ();
+        break;
+
+    case tok::real_literal:
+        E = Actions.actOnRealLiteral (Tok.getLocation (), Tok.getIdentifier ());
+        advance ();
+        break;
+
+    // A structured constant of an array type of its own
+    case tok::kw_ARRAY: {
+        Decl* D;
+        ExprList Exprs;
+        llvm::SMLoc Loc = Tok.getLocation ();
+        advance ();
+        if (!consume (tok::kw_OF) || !parseQualident (D))
+            return handle_err ();
+        D = Actions.actOnOpenArrayType (Loc, D);
+        if (!expect (tok::l_brace) || !parseAggregate (Exprs))
+            return handle_err ();
+        E = Actions.actOnAggregate (Loc, D, Exprs);
+        break;
+    }
+
     case tok::l_paren:
         advance ();
         if (!parseExpression (E))
@@ -961,6 +1264,43 @@ bool Parser::parseFactor (Expr*& E) {
 }
 
 
+/**
+ * Parses the elements of a structured constant in braces. An element that is
+ * itself in braces is a nested aggregate, whose type follows from the
+ * enclosing one.
+ *
+ * @param Elements The list to add the parsed elements to.
+ * @return `true` if the elements were parsed successfully, `false` otherwise.
+ * @example aggregate: `{1, 2, 3}`, `{{0, 0}, {1, 2}}`
+ */
+bool Parser::parseAggregate (ExprList& Elements) {
+    auto handle_err = [this] () { return skipUntil (tok::r_brace, tok::semi); };
+    if (!consume (tok::l_brace))
+        return handle_err ();
+
+    while (!Tok.is (tok::r_brace)) {
+        Expr* E = nullptr;
+        if (Tok.is (tok::l_brace)) {
+            ExprList Nested;
+            llvm::SMLoc Loc = Tok.getLocation ();
+            if (!parseAggregate (Nested))
+                return handle_err ();
+            E = Actions.actOnAggregate (Loc, nullptr, Nested);
+        } else if (!parseExpression (E)) {
+            return handle_err ();
+        }
+        Elements.push_back (E);
+
+        if (!Tok.is (tok::comma))
+            break;
+        advance ();
+    }
+
+    if (!consume (tok::r_brace))
+        return handle_err ();
+    return true;
+}
+
 /**
  * Parses a term in the input stream.
  *
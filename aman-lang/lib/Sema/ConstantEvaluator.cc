@@ -0,0 +1,119 @@
+#include "amanlang/Sema/ConstantEvaluator.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace amanlang;
+
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - ConstantEvaluator
+/////////////////////////////////////////////////////////////////////////////
+
+std::optional<int64_t> ConstantEvaluator::visitIntegerLiteral (IntegerLiteral* E) {
+    return E->getValue ().getSExtValue ();
+}
+
+std::optional<int64_t> ConstantEvaluator::visitConstantAccess (ConstantAccess* E) {
+    return evaluate (E->geDecl ()->getExpr ());
+}
+
+std::optional<int64_t> ConstantEvaluator::visitPrefixExpression (PrefixExpression* E) {
+    std::optional<int64_t> Value = evaluate (E->getExpr ());
+    if (Value && E->getOperatorInfo ().getKind () == tok::minus)
+        return -*Value;
+    return Value;
+}
+
+// Folds as CodeGen computes at runtime: DIV and MOD truncate toward zero. The
+// values are held as int64_t, so only the signed types are folded.
+std::optional<int64_t> ConstantEvaluator::visitInfixExpression (InfixExpression* E) {
+    PervasiveTypeDecl* IntTy = getIntegerType (E->getType ());
+    if (!IntTy || !IntTy->isSigned ())
+        return std::nullopt;
+    std::optional<int64_t> L = evaluate (E->getLeft ());
+    std::optional<int64_t> R = evaluate (E->getRight ());
+    if (!L || !R)
+        return std::nullopt;
+
+    int64_t Result;
+    switch (E->getOperatorInfo ().getKind ()) {
+    case tok::plus:
+        if (llvm::AddOverflow (*L, *R, Result))
+            return std::nullopt;
+        return Result;
+    case tok::minus:
+        if (llvm::SubOverflow (*L, *R, Result))
+            return std::nullopt;
+        return Result;
+    case tok::star:
+        if (llvm::MulOverflow (*L, *R, Result))
+            return std::nullopt;
+        return Result;
+    case tok::kw_DIV:
+    case tok::kw_MOD:
+        if (*R == 0 || (*L == INT64_MIN && *R == -1))
+            return std::nullopt;
+        return E->getOperatorInfo ().getKind () == tok::kw_DIV ? *L / *R : *L % *R;
+    default: return std::nullopt;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - RealConstantEvaluator
+/////////////////////////////////////////////////////////////////////////////
+
+std::optional<llvm::APFloat> RealConstantEvaluator::evaluate (Expr* E) {
+    if (!E)
+        return std::nullopt;
+    PervasiveTypeDecl* IntTy = getIntegerType (E->getType ());
+    if (!IntTy)
+        return visit (E);
+
+    std::optional<int64_t> Int = ConstantEvaluator ().evaluate (E);
+    if (!Int)
+        return std::nullopt;
+    llvm::APFloat Value (llvm::APFloat::IEEEdouble ());
+    Value.convertFromAPInt (llvm::APInt (64, *Int, IntTy->isSigned ()), IntTy->isSigned (),
+    llvm::APFloat::rmNearestTiesToEven);
+    return Value;
+}
+
+std::optional<llvm::APFloat> RealConstantEvaluator::visitRealLiteral (RealLiteral* E) {
+    bool LosesInfo;
+    llvm::APFloat Value = E->getValue ();
+    Value.convert (llvm::APFloat::IEEEdouble (), llvm::APFloat::rmNearestTiesToEven, &LosesInfo);
+    return Value;
+}
+
+std::optional<llvm::APFloat> RealConstantEvaluator::visitConstantAccess (ConstantAccess* E) {
+    return evaluate (E->geDecl ()->getExpr ());
+}
+
+std::optional<llvm::APFloat> RealConstantEvaluator::visitPrefixExpression (PrefixExpression* E) {
+    std::optional<llvm::APFloat> Value = evaluate (E->getExpr ());
+    if (Value && E->getOperatorInfo ().getKind () == tok::minus)
+        Value->changeSign ();
+    return Value;
+}
+
+// A result that is not finite is no constant; the expression is then
+// computed at runtime, as it would be without folding.
+std::optional<llvm::APFloat> RealConstantEvaluator::visitInfixExpression (InfixExpression* E) {
+    if (!getRealType (E->getType ()))
+        return std::nullopt;
+    std::optional<llvm::APFloat> L = evaluate (E->getLeft ());
+    std::optional<llvm::APFloat> R = evaluate (E->getRight ());
+    if (!L || !R)
+        return std::nullopt;
+
+    const llvm::RoundingMode RM = llvm::APFloat::rmNearestTiesToEven;
+    llvm::APFloat::opStatus Status;
+    switch (E->getOperatorInfo ().getKind ()) {
+    case tok::plus: Status = L->add (*R, RM); break;
+    case tok::minus: Status = L->subtract (*R, RM); break;
+    case tok::star: Status = L->multiply (*R, RM); break;
+    case tok::slash: Status = L->divide (*R, RM); break;
+    default: return std::nullopt;
+    }
+    if (Status & (llvm::APFloat::opInvalidOp | llvm::APFloat::opDivByZero | llvm::APFloat::opOverflow))
+        return std::nullopt;
+    return L;
+}
@@ -0,0 +1,355 @@
+#include "amanlang/Sema/EffectAnalysis.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Casting.h"
+#include <algorithm>
+
+using namespace amanlang;
+
+static void merge (ProcedureEffects::ModRef& Dst, ProcedureEffects::ModRef MR) {
+    Dst = static_cast<ProcedureEffects::ModRef> (Dst | MR);
+}
+
+static bool isSameEffects (const ProcedureEffects& L, const ProcedureEffects& R) {
+    return L.ArgMem == R.ArgMem && L.Globals == R.Globals && L.MayUnwind == R.MayUnwind &&
+    L.MayNotReturn == R.MayNotReturn && L.MayFailCheck == R.MayFailCheck &&
+    L.MayTrap == R.MayTrap && L.MayAllocate == R.MayAllocate && L.MayRecurse == R.MayRecurse;
+}
+
+static bool isThroughPointer (Designator* D) {
+    return llvm::any_of (D->getSelectors (),
+    [] (Selector* Sel) { return llvm::isa<DerefSelector> (Sel); });
+}
+
+static bool isOpenArray (Decl* D) {
+    auto* FP = llvm::dyn_cast<FormalParameterDecl> (D);
+    return FP && FP->isOpenArray ();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - EffectAnalysis (Call Graph)
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Summarizes all procedures of a module, including nested ones.
+ *
+ * Must run after the whole module has been checked, because a procedure may
+ * call procedures that are declared after it.
+ *
+ * @param Mod The module whose procedures are summarized.
+ */
+void EffectAnalysis::run (ModuleDecl* Mod) {
+    collect (Mod->getDecls ());
+
+    for (Node& N : Nodes) {
+        N.Local.ArgMem       = ProcedureEffects::MR_None;
+        N.Local.Globals      = ProcedureEffects::MR_None;
+        N.Local.MayUnwind    = false;
+        N.Local.MayNotReturn = false;
+        N.Local.MayFailCheck = false;
+        N.Local.MayTrap      = false;
+        N.Local.MayAllocate  = false;
+        N.Local.MayRecurse   = false;
+
+        Cur = &N;
+        visit (N.Proc->getStmts ());
+    }
+
+    // The module body has no summary, but may take addresses.
+    Node Body{ nullptr };
+    Cur = &Body;
+    visit (Mod->getStmts ());
+    Cur = nullptr;
+
+    for (unsigned Id = 0, E = Nodes.size (); Id != E; ++Id)
+        if (!Nodes[Id].Visited)
+            strongConnect (Id);
+}
+
+void EffectAnalysis::collect (const DeclList& Decls) {
+    for (Decl* D : Decls) {
+        if (auto* Proc = llvm::dyn_cast<ProcedureDecl> (D)) {
+            NodeIds[Proc] = Nodes.size ();
+            Nodes.push_back (Node{ Proc });
+            collect (Proc->getDecls ());
+        }
+    }
+}
+
+void EffectAnalysis::visitAssignmentStatement (AssignmentStatement* S) {
+    visit (S->getExpr ());
+    scanDesignator (S->getVar (), ProcedureEffects::MR_Mod);
+}
+
+void EffectAnalysis::visitProcedureCallStatement (ProcedureCallStatement* S) {
+    scanCall (S->getProc (), S->getParams ());
+}
+
+void EffectAnalysis::visitIfStatement (IfStatement* S) {
+    visit (S->getCond ());
+    visit (S->getIfStmts ());
+    visit (S->getElseStmts ());
+}
+
+// Without an ELSE part, a selector no label matches fails a runtime check.
+// Unlike bounds and division checks, this one is always emitted.
+void EffectAnalysis::visitCaseStatement (CaseStatement* S) {
+    if (!S->hasElse ())
+        Cur->Local.MayTrap = true;
+    visit (S->getSelector ());
+    for (const CaseAlternative& Alt : S->getCases ())
+        visit (Alt.Stmts);
+    visit (S->getElseStmts ());
+}
+
+void EffectAnalysis::visitWhileStatement (WhileStatement* S) {
+    // Termination of a WHILE loop can't be proven in general.
+    Cur->Local.MayNotReturn = true;
+    visit (S->getCond ());
+    visit (S->getStmts ());
+}
+
+// A FOR loop runs a number of times fixed on entry, so unlike WHILE it
+// always terminates. Its control variable is a local.
+void EffectAnalysis::visitForStatement (ForStatement* S) {
+    visit (S->getStart ());
+    visit (S->getEnd ());
+    visit (S->getStmts ());
+}
+
+void EffectAnalysis::visitReturnStatement (ReturnStatement* S) {
+    if (S->getExpr ())
+        visit (S->getExpr ());
+}
+
+void EffectAnalysis::visitNewStatement (NewStatement* S) {
+    Cur->Local.MayAllocate = true;
+    scanDesignator (S->getPtr (), ProcedureEffects::MR_Mod);
+}
+
+void EffectAnalysis::visitDisposeStatement (DisposeStatement* S) {
+    Cur->Local.MayAllocate = true;
+    scanDesignator (S->getPtr (), ProcedureEffects::MR_ModRef);
+}
+
+// MayUnwind also stands for the C++ runtime's exception state, which RAISE
+// and the handlers of TRY modify; see addEffectAttributes.
+void EffectAnalysis::visitRaiseStatement (RaiseStatement*) {
+    Cur->Local.MayUnwind = true;
+}
+
+// Conservatively, exceptions raised inside still count as unwinding, even if
+// a handler catches them, so the handler's runtime calls are accounted for.
+void EffectAnalysis::visitTryStatement (TryStatement* S) {
+    ++TryDepth;
+    visit (S->getStmts ());
+    --TryDepth;
+    for (const ExceptHandler& H : S->getHandlers ())
+        visit (H.Stmts);
+    visit (S->getElseStmts ());
+}
+
+void EffectAnalysis::visitInfixExpression (InfixExpression* E) {
+    // Only a constant divisor is known not to be zero.
+    tok::TokenKind Op = E->getOperatorInfo ().getKind ();
+    if ((Op == tok::kw_DIV || Op == tok::kw_MOD) && !llvm::isa<IntegerLiteral> (E->getRight ()))
+        Cur->Local.MayFailCheck = true;
+    visit (E->getLeft ());
+    visit (E->getRight ());
+}
+
+void EffectAnalysis::visitPrefixExpression (PrefixExpression* E) {
+    visit (E->getExpr ());
+}
+
+void EffectAnalysis::visitDesignator (Designator* E) {
+    scanDesignator (E, ProcedureEffects::MR_Ref);
+}
+
+void EffectAnalysis::visitFunctionCallExpr (FunctionCallExpr* E) {
+    scanCall (E->geDecl (), E->getParams ());
+}
+
+void EffectAnalysis::visitConversionExpr (ConversionExpr* E) {
+    visit (E->getExpr ());
+}
+
+/**
+ * Records an access of a designator.
+ *
+ * Index expressions are read in any case. Going through a pointer only reads
+ * the variable holding the pointer; the access itself hits heap memory.
+ *
+ * @param D The accessed designator.
+ * @param MR Whether the designator is read or written.
+ */
+void EffectAnalysis::scanDesignator (Designator* D, ProcedureEffects::ModRef MR) {
+    scanIndices (D);
+
+    bool ThroughPointer = isThroughPointer (D);
+    ProcedureEffects::ModRef BaseMR = ThroughPointer ? ProcedureEffects::MR_Ref : MR;
+    switch (classify (D)) {
+    case MC_Local: break;
+    case MC_ArgMem: merge (Cur->Local.ArgMem, BaseMR); break;
+    case MC_Globals: merge (Cur->Local.Globals, BaseMR); break;
+    }
+    if (ThroughPointer)
+        merge (Cur->Local.Globals, MR);
+}
+
+// Reads the index expressions. Only a constant index into an array of fixed
+// length is known to be in range; an open array may be of any length.
+void EffectAnalysis::scanIndices (Designator* D) {
+    bool Open = isOpenArray (D->getDecl ());
+    for (Selector* Sel : D->getSelectors ()) {
+        if (auto* Idx = llvm::dyn_cast<IndexSelector> (Sel)) {
+            Cur->Local.MayFailCheck |= Open || !llvm::isa<IntegerLiteral> (Idx->getIndex ());
+            visit (Idx->getIndex ());
+        }
+        Open = false;
+    }
+}
+
+/**
+ * Records a call. VAR arguments are not accessed by the caller; instead the
+ * memory class of each one is remembered, so the callee's argument memory
+ * effects can be mapped back onto the caller once they are known. Open arrays
+ * are passed the same way. Variables passed this way are marked as
+ * address-taken for CodeGen's alias scopes. So are value parameters passed
+ * this way inside a TRY statement: CodeGen copies them back after the call,
+ * which an exception skips, so they need a stack slot of their own.
+ */
+void EffectAnalysis::scanCall (ProcedureDecl* Callee, const ExprList& Args) {
+    CallSite CS{ Callee };
+    const FormalParamList& Formals = Callee->getFormalParams ();
+    for (size_t I = 0, E = Args.size (); I != E; ++I) {
+        auto* Desig = llvm::dyn_cast<Designator> (Args[I]);
+        if (!Desig || I >= Formals.size () || (!Formals[I]->isVar () && !Formals[I]->isOpenArray ())) {
+            visit (Args[I]);
+            continue;
+        }
+
+        if (isThroughPointer (Desig)) {
+            scanDesignator (Desig, ProcedureEffects::MR_None);
+            CS.VarArgs.push_back (MC_Globals);
+            continue;
+        }
+
+        scanIndices (Desig);
+        if (auto* Var = llvm::dyn_cast<VariableDecl> (Desig->getDecl ()))
+            Var->setAddressTaken ();
+        else if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Desig->getDecl ()); FP && TryDepth)
+            FP->setAddressTaken ();
+        CS.VarArgs.push_back (classify (Desig));
+    }
+    Cur->Calls.push_back (CS);
+}
+
+EffectAnalysis::MemClass EffectAnalysis::classify (Designator* D) {
+    Decl* Var = D->getDecl ();
+
+    // Structured constants are never written, so reading them is no effect.
+    if (llvm::isa<ConstantDecl> (Var))
+        return MC_Local;
+
+    // Module variables, and variables of an enclosing procedure, which
+    // are not owned by this invocation either.
+    if (Var->getEnclosingDecl () != Cur->Proc)
+        return MC_Globals;
+
+    if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Var))
+        return FP->isVar () || FP->isOpenArray () ? MC_ArgMem : MC_Local;
+    return MC_Local;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - EffectAnalysis (Propagation)
+/////////////////////////////////////////////////////////////////////////////
+
+void EffectAnalysis::strongConnect (unsigned Id) {
+    Nodes[Id].Visited = true;
+    Nodes[Id].Index   = NextIndex;
+    Nodes[Id].LowLink = NextIndex;
+    Nodes[Id].OnStack = true;
+    ++NextIndex;
+    Stack.push_back (Id);
+
+    for (const CallSite& CS : Nodes[Id].Calls) {
+        auto It = NodeIds.find (CS.Callee);
+        if (It == NodeIds.end ())
+            continue;
+
+        unsigned Callee = It->second;
+        if (!Nodes[Callee].Visited) {
+            strongConnect (Callee);
+            Nodes[Id].LowLink = std::min (Nodes[Id].LowLink, Nodes[Callee].LowLink);
+        } else if (Nodes[Callee].OnStack) {
+            Nodes[Id].LowLink = std::min (Nodes[Id].LowLink, Nodes[Callee].Index);
+        }
+    }
+
+    if (Nodes[Id].LowLink != Nodes[Id].Index)
+        return;
+
+    llvm::SmallVector<unsigned, 4> SCC;
+    unsigned Member;
+    do {
+        Member                = Stack.pop_back_val ();
+        Nodes[Member].OnStack = false;
+        SCC.push_back (Member);
+    } while (Member != Id);
+    summarize (SCC);
+}
+
+/**
+ * Computes the final summaries of one strongly connected component.
+ *
+ * Callees outside of the component are already final. The members start out
+ * with their local effects and are iterated until nothing changes; the
+ * lattice is tiny, so this takes only a few rounds.
+ *
+ * @param SCC The node ids of the component.
+ */
+void EffectAnalysis::summarize (llvm::ArrayRef<unsigned> SCC) {
+    bool IsCycle = SCC.size () > 1;
+    for (const CallSite& CS : Nodes[SCC.front ()].Calls)
+        IsCycle |= CS.Callee == Nodes[SCC.front ()].Proc;
+
+    for (unsigned Id : SCC) {
+        ProcedureEffects E = Nodes[Id].Local;
+        E.MayRecurse       = IsCycle;
+        E.MayNotReturn |= IsCycle;
+        E.Computed = true;
+        Nodes[Id].Proc->setEffects (E);
+    }
+
+    bool Changed = true;
+    while (Changed) {
+        Changed = false;
+        for (unsigned Id : SCC) {
+            Node& N            = Nodes[Id];
+            ProcedureEffects E = N.Proc->getEffects ();
+            for (const CallSite& CS : N.Calls) {
+                // Procedures outside of the module keep the conservative defaults.
+                const ProcedureEffects& Callee = CS.Callee->getEffects ();
+                merge (E.Globals, Callee.Globals);
+                for (MemClass MC : CS.VarArgs) {
+                    if (MC == MC_ArgMem)
+                        merge (E.ArgMem, Callee.ArgMem);
+                    else if (MC == MC_Globals)
+                        merge (E.Globals, Callee.ArgMem);
+                }
+                E.MayUnwind |= Callee.MayUnwind;
+                E.MayNotReturn |= Callee.MayNotReturn;
+                E.MayFailCheck |= Callee.MayFailCheck;
+                E.MayTrap |= Callee.MayTrap;
+                E.MayAllocate |= Callee.MayAllocate;
+                E.MayRecurse |= !Callee.Computed;
+            }
+
+            if (!isSameEffects (E, N.Proc->getEffects ())) {
+                N.Proc->setEffects (E);
+                Changed = true;
+            }
+        }
+    }
+}
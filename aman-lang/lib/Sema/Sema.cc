@@ -1,7 +1,12 @@
 #include "amanlang/Sema/Sema.h"
 #include "amanlang/AST/AST.h"
 #include "amanlang/Basic/Diagnostic.h"
+#include "amanlang/Sema/ConstantEvaluator.h"
+#include "amanlang/Sema/EffectAnalysis.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Error.h"
 
 using namespace amanlang;
 
@@ -26,10 +31,10 @@ bool Sema::isOperatorForType (tok::TokenKind Op, TypeDecl* Ty) {
     switch (Op) {
     case tok::plus:
     case tok::minus:
-    case tok::star:
+    case tok::star: return getIntegerType (Ty) || getRealType (Ty);
     case tok::kw_DIV:
-    case tok::kw_MOD: return Ty == IntegerType;
-    case tok::slash: return false; // REAL not implemented
+    case tok::kw_MOD: return getIntegerType (Ty) != nullptr;
+    case tok::slash: return getRealType (Ty) != nullptr;
     case tok::kw_AND:
     case tok::kw_OR:
     case tok::kw_NOT: return Ty == BooleanType;
@@ -37,9 +42,70 @@ bool Sema::isOperatorForType (tok::TokenKind Op, TypeDecl* Ty) {
     }
 }
 
+// Folds the constant expressions that may appear where the language asks for
+// a constant, see ConstantEvaluator.
+bool Sema::evaluateConstant (Expr* E, int64_t& Value) {
+    std::optional<int64_t> V = ConstantEvaluator ().evaluate (E);
+    if (V)
+        Value = *V;
+    return V.has_value ();
+}
+
+// Folds a constant of an integer or real type to a LONGREAL value, see
+// RealConstantEvaluator.
+bool Sema::evaluateRealConstant (Expr* E, llvm::APFloat& Value) {
+    std::optional<llvm::APFloat> V = RealConstantEvaluator ().evaluate (E);
+    if (V)
+        Value = *V;
+    return V.has_value ();
+}
+
+// Folds a label of a CASE statement to a constant of the selector type Ty.
+bool Sema::evaluateCaseLabel (Expr* E, TypeDecl* Ty, llvm::APSInt& Value) {
+    PervasiveTypeDecl* IntTy = getIntegerType (Ty);
+    int64_t V;
+    E = convertTo (E, Ty);
+    if (!E || !E->isConst () || !evaluateConstant (E, V))
+        return false;
+    // V holds the bits of the label, sign extended to 64 bits.
+    Value = llvm::APSInt (llvm::APInt (IntTy->getBitWidth (), V, true), !IntTy->isSigned ());
+    return true;
+}
+
+// The control variable of a FOR statement may not be changed by its body.
+// Neither may a value open array, which is the caller's array, nor a
+// structured constant.
+void Sema::checkAssignable (llvm::SMLoc Loc, Expr* E) {
+    auto* Desig = llvm::dyn_cast_or_null<Designator> (E);
+    if (!Desig)
+        return;
+    if (ForControlVars.count (Desig->getDecl ()))
+        Diag.report (Loc, diag::err_for_control_var_changed, Desig->getDecl ()->getName ());
+    if (llvm::isa<ConstantDecl> (Desig->getDecl ()))
+        Diag.report (Loc, diag::err_constant_not_assignable, Desig->getDecl ()->getName ());
+    if (auto* FP = llvm::dyn_cast<FormalParameterDecl> (Desig->getDecl ()))
+        if (FP->isOpenArray () && !FP->isVar ())
+            Diag.report (Loc, diag::err_open_array_not_assignable, FP->getName ());
+}
+
 void Sema::initalize () {
-    IntegerType = new PervasiveTypeDecl (CurDecl, llvm::SMLoc (), "Integer");
-    BooleanType = new PervasiveTypeDecl (CurDecl, llvm::SMLoc (), "Boolean");
+    using Kind = PervasiveTypeDecl::PervasiveKind;
+    auto Pervasive = [this] (llvm::StringRef Name, Kind K, unsigned BitWidth) {
+        return new PervasiveTypeDecl (CurDecl, llvm::SMLoc (), Name, K, BitWidth);
+    };
+    IntegerType  = Pervasive ("INTEGER", Kind::PK_Signed, 64);
+    Int8Type     = Pervasive ("INT8", Kind::PK_Signed, 8);
+    Int16Type    = Pervasive ("INT16", Kind::PK_Signed, 16);
+    Int32Type    = Pervasive ("INT32", Kind::PK_Signed, 32);
+    CardinalType = Pervasive ("CARDINAL", Kind::PK_Unsigned, 64);
+    BooleanType  = Pervasive ("BOOLEAN", Kind::PK_Boolean, 1);
+    RealType     = Pervasive ("REAL", Kind::PK_Real, 32);
+    LongRealType = Pervasive ("LONGREAL", Kind::PK_Real, 64);
+
+    // Only looked up by name, see actOnNewOrDispose.
+    NewProc     = new ProcedureDecl (CurDecl, llvm::SMLoc (), "NEW");
+    DisposeProc = new ProcedureDecl (CurDecl, llvm::SMLoc (), "DISPOSE");
+    HighProc    = new ProcedureDecl (CurDecl, llvm::SMLoc (), "HIGH");
 
     TrueLiteral  = new BooleanLiteral (true, BooleanType);
     FalseLiteral = new BooleanLiteral (false, BooleanType);
@@ -48,11 +114,118 @@ void Sema::initalize () {
     FalseConst = new ConstantDecl (CurDecl, llvm::SMLoc (), "FalseConst", FalseLiteral);
 
     CurScope->insert (IntegerType);
+    CurScope->insert ("INT64", IntegerType);
+    CurScope->insert (Int8Type);
+    CurScope->insert (Int16Type);
+    CurScope->insert (Int32Type);
+    CurScope->insert (CardinalType);
     CurScope->insert (BooleanType);
+    CurScope->insert (RealType);
+    CurScope->insert (LongRealType);
+    CurScope->insert (NewProc);
+    CurScope->insert (DisposeProc);
+    CurScope->insert (HighProc);
     CurScope->insert (TrueConst);
     CurScope->insert (FalseConst);
 }
 
+/////////////////////////////////////////////////////////////////////////////
+#pragma mark - Integer and Real Conversions
+/////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Converts an expression implicitly to the given type.
+ *
+ * Integer types of the same signedness are compatible: a value widens to a
+ * type with at least as many bits, while narrowing requires an explicit
+ * conversion. A constant takes any integer type its value fits into, so it
+ * is folded into a literal of that type. Real types follow convertToReal.
+ *
+ * @param E The expression to convert.
+ * @param Ty The type the expression is used as.
+ * @return The converted expression, or nullptr if the types are not compatible.
+ * @example `VAR c: INT8; i: INTEGER;` allows `i := c` and `c := 100`, but not `c := i`.
+ */
+Expr* Sema::convertTo (Expr* E, TypeDecl* Ty) {
+    if (!E || E->getType () == Ty)
+        return E;
+    if (getRealType (Ty))
+        return convertToReal (E, Ty);
+
+    PervasiveTypeDecl* From = getIntegerType (E->getType ());
+    PervasiveTypeDecl* To   = getIntegerType (Ty);
+    if (!From || !To)
+        return nullptr;
+
+    int64_t Value;
+    if (E->isConst () && From->isSigned () && evaluateConstant (E, Value)) {
+        llvm::APSInt V (llvm::APInt (64, Value, true), false);
+        llvm::APSInt Converted = V.extOrTrunc (To->getBitWidth ());
+        Converted.setIsSigned (To->isSigned ());
+        if (!llvm::APSInt::isSameValue (V, Converted))
+            return nullptr;
+        return new IntegerLiteral (llvm::SMLoc (), Converted, Ty);
+    }
+
+    if (From->isSigned () != To->isSigned () || From->getBitWidth () > To->getBitWidth ())
+        return nullptr;
+    return new ConversionExpr (E, Ty);
+}
+
+/**
+ * Converts an expression implicitly to a real type. REAL widens to LONGREAL.
+ * A constant, integer or real, takes either real type; any other integer
+ * requires an explicit conversion.
+ *
+ * @param E The expression to convert.
+ * @param Ty The real type the expression is used as.
+ * @return The converted expression, or nullptr if the types are not compatible.
+ * @example `VAR r: REAL; d: LONGREAL; i: INTEGER;` allows `d := r`, `r := 1.0 / 3.0` and `d := 2 * 3`,
+ * but not `d := i`.
+ */
+Expr* Sema::convertToReal (Expr* E, TypeDecl* Ty) {
+    if (E->isConst ())
+        if (RealLiteral* Lit = foldReal (E, Ty))
+            return Lit;
+
+    PervasiveTypeDecl* From = getRealType (E->getType ());
+    if (!From || From->getBitWidth () > getRealType (Ty)->getBitWidth ())
+        return nullptr;
+    return new ConversionExpr (E, Ty);
+}
+
+// Folds a constant, integer or real, into a literal of the real type Ty,
+// rounded to the nearest value of the type. Returns nullptr if E is not a
+// constant or its value is out of the range of Ty.
+RealLiteral* Sema::foldReal (Expr* E, TypeDecl* Ty) {
+    llvm::APFloat Value (0.0);
+    if (!E || !E->isConst () || !evaluateRealConstant (E, Value))
+        return nullptr;
+
+    bool LosesInfo;
+    const llvm::fltSemantics& Sem = getRealType (Ty)->getBitWidth () == 32 ?
+    llvm::APFloat::IEEEsingle () :
+    llvm::APFloat::IEEEdouble ();
+    if (Value.convert (Sem, llvm::APFloat::rmNearestTiesToEven, &LosesInfo) & llvm::APFloat::opOverflow)
+        return nullptr;
+    return new RealLiteral (llvm::SMLoc (), Value, Ty);
+}
+
+// Converts the operands of an infix operator to a common type. A constant
+// adapts to the other operand; otherwise the narrower operand is widened.
+bool Sema::convertOperands (Expr*& Left, Expr*& Right) {
+    auto Convert = [this] (Expr*& From, Expr* To) {
+        if (Expr* E = convertTo (From, To->getType ())) {
+            From = E;
+            return true;
+        }
+        return false;
+    };
+    if (Left->isConst () && !Right->isConst ())
+        return Convert (Left, Right) || Convert (Right, Left);
+    return Convert (Right, Left) || Convert (Left, Right);
+}
+
 /////////////////////////////////////////////////////////////////////////////
 #pragma mark - Action (Declaration)
 /////////////////////////////////////////////////////////////////////////////
@@ -88,6 +261,9 @@ StmtList& Stmts) {
     }
     ModDecl->setDecls (Decls);
     ModDecl->setStmts (Stmts);
+
+    // All procedures are known now, so their side effects can be summarized.
+    EffectAnalysis ().run (ModDecl);
 }
 
 void Sema::actOnImport (llvm::StringRef ModuleName, IdentList& Ids) {
@@ -148,6 +324,24 @@ void Sema::actOnVariableDeclaration (DeclList& Decls, IdentList& Ids, Decl* D) {
     }
 }
 
+/**
+ * Handles the declaration of exceptions in the current scope.
+ *
+ * @param Decls The list of declarations to add the new exception declarations to.
+ * @param Ids The names of the exceptions.
+ * @example `EXCEPTION NotFound, Overflow;`
+ */
+void Sema::actOnExceptionDeclaration (DeclList& Decls, IdentList& Ids) {
+    assert (CurScope && "CurrentScope not set");
+    for (auto& [Loc, Name] : Ids) {
+        ExceptionDecl* Decl = new ExceptionDecl (CurDecl, Loc, Name);
+        if (CurScope->insert (Decl))
+            Decls.push_back (Decl);
+        else
+            Diag.report (Loc, diag::err_symbold_declared, Name);
+    }
+}
+
 /**
  * Handles the declaration of formal parameters for a function or method.
  *
@@ -167,7 +361,7 @@ IdentList& Ids,
 Decl* D,
 bool IsVar) {
     assert (CurScope && "CurrentScope not set");
-    if (TypeDecl* Ty = llvm::dyn_cast<TypeDecl> (D)) {
+    if (TypeDecl* Ty = llvm::dyn_cast_or_null<TypeDecl> (D)) {
         for (auto& [Loc, Name] : Ids) {
             FormalParameterDecl* Decl =
             new FormalParameterDecl (CurDecl, Loc, Name, Ty, IsVar);
@@ -182,6 +376,24 @@ bool IsVar) {
     }
 }
 
+/**
+ * Creates the type of an open array parameter.
+ *
+ * The type is anonymous and not added to any scope; every parameter declared
+ * as `ARRAY OF T` gets a type of its own.
+ *
+ * @param Loc The source location of `ARRAY`.
+ * @param D The element type.
+ * @return The open array type, or nullptr if D is not a type.
+ * @example `PROCEDURE Sum (a: ARRAY OF INTEGER): INTEGER;`
+ */
+TypeDecl* Sema::actOnOpenArrayType (llvm::SMLoc Loc, Decl* D) {
+    if (auto* Ty = llvm::dyn_cast_or_null<TypeDecl> (D))
+        return new OpenArrayTypeDecl (CurDecl, Loc, Ty);
+    Diag.report (Loc, diag::err_vardecl_requires_type);
+    return nullptr;
+}
+
 /**
  * Creates a new procedure declaration and adds it to the current scope.
  *
@@ -201,6 +413,25 @@ ProcedureDecl* Sema::actOnProcedureDeclaration (llvm::SMLoc Loc, llvm::StringRef
     return P;
 }
 
+/**
+ * Exports a procedure, so other modules may call it.
+ *
+ * Procedures without the export mark are only visible in their module, which
+ * lets CodeGen give them internal linkage and a faster calling convention.
+ * Nested procedures can't be exported.
+ *
+ * @param ProcDecl The procedure to export.
+ * @param Loc The source location of the export mark.
+ * @example `PROCEDURE GCD* (a, b: INTEGER): INTEGER;`
+ */
+void Sema::actOnExportMark (ProcedureDecl* ProcDecl, llvm::SMLoc Loc) {
+    if (!llvm::isa<ModuleDecl> (ProcDecl->getEnclosingDecl ())) {
+        Diag.report (Loc, diag::err_export_requires_module_level);
+        return;
+    }
+    ProcDecl->setExported ();
+}
+
 /**
  * Creates a new procedure declaration and adds it to the current scope.
  *
@@ -296,7 +527,7 @@ llvm::StringRef Name,
 Expr* E,
 Decl* D) {
     assert (CurScope && "CurrentScope not set");
-    if (E && E->isConst () && E->getType ()->getName () == "INTEGER") {
+    if (E && E->isConst () && getIntegerType (E->getType ())) {
         if (TypeDecl* Ty = llvm::dyn_cast<TypeDecl> (D)) {
             ArrayTypeDecl* Decl = new ArrayTypeDecl (CurDecl, Loc, Name, E, Ty);
             if (CurScope->insert (Decl))
@@ -416,11 +647,17 @@ const FieldList& Fields) {
  */
 void Sema::actOnAssignment (StmtList& Stmts, llvm::SMLoc Loc, Expr* D, Expr* E) {
     if (auto Var = llvm::dyn_cast<Designator> (D)) {
-        if (Var->getType () != E->getType ()) {
+        if (Expr* Converted = convertTo (E, Var->getType ())) {
+            E = Converted;
+        } else {
             Diag.report (Loc, diag::err_types_for_operator_not_compatible,
             tok::getPunctuatorSpelling (tok::colonequal));
         }
-        Stmts.push_back (new AssignmentStatement (Var, E));
+        checkAssignable (Loc, Var);
+        // An open array has no value of its own, only its elements.
+        if (llvm::isa<OpenArrayTypeDecl> (Var->getType ()))
+            Diag.report (Loc, diag::err_open_array_not_assignable, Var->getDecl ()->getName ());
+        Stmts.push_back (new AssignmentStatement (Loc, Var, E));
     } else if (!Stmts.empty ()) {
         llvm::SMLoc Loc = llvm::SMLoc ();
         Diag.report (Loc, diag::err_expected);
@@ -433,7 +670,9 @@ void Sema::actOnAssignment (StmtList& Stmts, llvm::SMLoc Loc, Expr* D, Expr* E)
  *
  * This function compares the number of formal parameters to the number of actual arguments,
  * and ensures that the types of the formal parameters and actual arguments are compatible.
- * If any mismatches are found, appropriate error diagnostics are reported.
+ * Arguments of value parameters are converted to the parameter type; a VAR parameter
+ * requires a variable of exactly its type. If any mismatches are found, appropriate
+ * error diagnostics are reported.
  *
  * @param Loc The source location of the procedure call.
  * @param Formals The list of formal parameters for the procedure.
@@ -441,7 +680,7 @@ void Sema::actOnAssignment (StmtList& Stmts, llvm::SMLoc Loc, Expr* D, Expr* E)
  */
 void Sema::checkFormalAndActualParameters (llvm::SMLoc Loc,
 const FormalParamList& Formals,
-const ExprList& Actuals) {
+ExprList& Actuals) {
     // argument vs param mismatch
     if (Formals.size () != Actuals.size ()) {
         Diag.report (Loc, diag::err_wrong_number_of_parameters);
@@ -451,14 +690,46 @@ const ExprList& Actuals) {
     auto A = Actuals.begin ();
     for (auto it = Formals.begin (); it != Formals.end (); ++it, ++A) {
         FormalParameterDecl* F = *it;
-        Expr* Arg              = *A;
-        if (F->getType () != Arg->getType ())
+        Expr*& Arg             = *A;
+        if (auto* Open = llvm::dyn_cast<OpenArrayTypeDecl> (F->getType ())) {
+            if (!isCompatibleOpenArray (Open, Arg))
+                Diag.report (Loc, diag::err_type_of_formal_and_actual_parameter_not_compatible);
+        } else if (!F->isVar ()) {
+            if (Expr* Converted = convertTo (Arg, F->getType ()))
+                Arg = Converted;
+            else
+                Diag.report (Loc, diag::err_type_of_formal_and_actual_parameter_not_compatible);
+        } else if (F->getType () != Arg->getType ()) {
             Diag.report (Loc, diag::err_type_of_formal_and_actual_parameter_not_compatible);
-        if (F->isVar () && llvm::isa<Designator> (Arg))
+        }
+        if (F->isVar () && !llvm::isa<Designator> (Arg))
             Diag.report (Loc, diag::err_var_parameter_requires_var);
+        if (F->isVar ())
+            checkAssignable (Loc, Arg);
     }
 }
 
+/**
+ * Checks an argument of an open array parameter.
+ *
+ * The argument must be a variable: an array of the same element type, or an
+ * open array parameter, which is passed on with its length.
+ *
+ * @param Formal The type of the open array parameter.
+ * @param Arg The actual argument.
+ * @return `true` if the argument can be passed.
+ * @example `Sum (v)` with `VAR v: Vector;` and `TYPE Vector = ARRAY [8] OF INTEGER;`
+ */
+bool Sema::isCompatibleOpenArray (OpenArrayTypeDecl* Formal, Expr* Arg) {
+    if (!llvm::isa_and_nonnull<Designator> (Arg))
+        return false;
+    if (auto* Arr = llvm::dyn_cast<ArrayTypeDecl> (Arg->getType ()))
+        return Arr->getType () == Formal->getType ();
+    if (auto* Open = llvm::dyn_cast<OpenArrayTypeDecl> (Arg->getType ()))
+        return Open->getType () == Formal->getType ();
+    return false;
+}
+
 /**
  * Handles the action of calling a procedure.
  *
@@ -473,15 +744,44 @@ const ExprList& Actuals) {
  * @param Params The list of actual arguments provided in the procedure call.
  */
 void Sema::actOnProcCall (StmtList& Stmts, llvm::SMLoc Loc, Decl* D, ExprList& Params) {
-    if (auto Proc = llvm::dyn_cast<ProcedureDecl> (D)) {
+    if (D && (D == NewProc || D == DisposeProc)) {
+        actOnNewOrDispose (Stmts, Loc, llvm::cast<ProcedureDecl> (D), Params);
+    } else if (auto Proc = llvm::dyn_cast<ProcedureDecl> (D)) {
         checkFormalAndActualParameters (Loc, Proc->getFormalParams (), Params);
-        Stmts.push_back (new ProcedureCallStatement (Proc, Params));
+        Stmts.push_back (new ProcedureCallStatement (Loc, Proc, Params));
     } else {
         Diag.report (Loc, diag::err_expected);
     }
 }
 
 
+/**
+ * Handles a call of the pervasive procedures NEW and DISPOSE.
+ *
+ * Both take a single variable of a pointer type. NEW sets it to a new,
+ * uninitialized object of the pointer's base type, and DISPOSE frees the
+ * object it points to and sets it to NIL.
+ *
+ * @param Stmts The list of statements to add the new statement to.
+ * @param Loc The source location of the call.
+ * @param Proc NEW or DISPOSE.
+ * @param Params The list of actual arguments provided in the call.
+ * @example `NEW (p)`, `DISPOSE (list^.next)`
+ */
+void Sema::actOnNewOrDispose (StmtList& Stmts, llvm::SMLoc Loc, ProcedureDecl* Proc, ExprList& Params) {
+    auto* Ptr = Params.size () == 1 ? llvm::dyn_cast<Designator> (Params.front ()) : nullptr;
+    if (!Ptr || !llvm::isa<PointerTypeDecl> (Ptr->getType ())) {
+        Diag.report (Loc, diag::err_requires_pointer_variable, Proc->getName ());
+        return;
+    }
+
+    checkAssignable (Loc, Ptr);
+    if (Proc == NewProc)
+        Stmts.push_back (new NewStatement (Loc, Ptr));
+    else
+        Stmts.push_back (new DisposeStatement (Loc, Ptr));
+}
+
 /**
  * Handles the action of an if statement.
  *
@@ -505,7 +805,98 @@ StmtList& ElseStmts) {
     //     if (auto Proc = llvm::dyn_cast<BooleanLiteral> (Cond)) {
     if (Cond->getType () != BooleanType)
         Diag.report (Loc, diag::err_if_expr_must_be_bool);
-    Stmts.push_back (new IfStatement (Cond, IfStmts, ElseStmts));
+    Stmts.push_back (new IfStatement (Loc, Cond, IfStmts, ElseStmts));
+}
+
+/**
+ * Handles the selector of a case statement, before its alternatives are parsed.
+ *
+ * @param Loc The source location of the case statement.
+ * @param Selector The expression selecting the alternative.
+ * @return The case statement without its alternatives, or nullptr on error.
+ */
+CaseStatement* Sema::actOnCaseStatement (llvm::SMLoc Loc, Expr* Selector) {
+    if (!Selector || !getIntegerType (Selector->getType ())) {
+        Diag.report (Loc, diag::err_case_expr_must_be_integer);
+        return nullptr;
+    }
+    return new CaseStatement (Loc, Selector);
+}
+
+/**
+ * Handles one label of a case statement. The bounds are folded to constants
+ * of the selector type, and no value may be handled by two labels of the same
+ * case statement.
+ *
+ * @param Case The case statement returned for the selector, or nullptr.
+ * @param Labels The labels of the alternative parsed so far.
+ * @param Loc The source location of the label.
+ * @param Low The value of the label, or the lower bound of a range.
+ * @param High The upper bound of a range, or nullptr.
+ * @example `CASE op OF 0, 2: ... | 1 .. 9: ... END` is rejected, 2 overlaps 1 .. 9.
+ */
+void Sema::actOnCaseLabel (CaseStatement* Case, CaseLabelList& Labels, llvm::SMLoc Loc, Expr* Low, Expr* High) {
+    if (!Case)
+        return;
+
+    TypeDecl* Ty = Case->getSelector ()->getType ();
+    CaseLabel Label;
+    if (!evaluateCaseLabel (Low, Ty, Label.Low) || (High && !evaluateCaseLabel (High, Ty, Label.High))) {
+        Diag.report (Loc, diag::err_case_label_not_constant, Ty->getName ());
+        return;
+    }
+    if (!High)
+        Label.High = Label.Low;
+    if (Label.High < Label.Low) {
+        Diag.report (Loc, diag::err_case_label_empty_range);
+        return;
+    }
+
+    auto IsDisjoint = [&] (const CaseLabelList& Others) {
+        for (const CaseLabel& Other : Others) {
+            if (Label.Low <= Other.High && Other.Low <= Label.High) {
+                Diag.report (Loc, diag::err_case_label_duplicate,
+                llvm::toString (std::max (Label.Low, Other.Low), 10));
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!IsDisjoint (Labels))
+        return;
+    for (const CaseAlternative& Alt : Case->getCases ())
+        if (!IsDisjoint (Alt.Labels))
+            return;
+    Labels.push_back (Label);
+}
+
+/**
+ * Adds an alternative to a case statement.
+ *
+ * @param Case The case statement returned for the selector, or nullptr.
+ * @param Labels The labels of the alternative, checked by actOnCaseLabel.
+ * @param CaseStmts The list of statements run for the labels.
+ */
+void Sema::actOnCase (CaseStatement* Case, CaseLabelList& Labels, StmtList& CaseStmts) {
+    if (Case && !Labels.empty ())
+        Case->addCase (Labels, CaseStmts);
+}
+
+/**
+ * Completes a case statement and adds it to the list of statements.
+ *
+ * @param Stmts The list of statements to add the case statement to.
+ * @param Case The case statement returned for the selector, or nullptr.
+ * @param ElseStmts The list of statements run if no label matches.
+ * @param HasElse Whether there is an ELSE part, which may be empty.
+ */
+void Sema::actOnCaseStatement (StmtList& Stmts, CaseStatement* Case, StmtList& ElseStmts, bool HasElse) {
+    if (!Case)
+        return;
+
+    if (HasElse)
+        Case->setElseStmts (ElseStmts);
+    Stmts.push_back (Case);
 }
 
 /**
@@ -526,7 +917,65 @@ void Sema::actOnWhileStatement (StmtList& Stmts, llvm::SMLoc Loc, Expr* Cond, St
     //     if (auto Proc = llvm::dyn_cast<BooleanLiteral> (Cond)) {
     if (Cond->getType () != BooleanType)
         Diag.report (Loc, diag::err_if_expr_must_be_bool);
-    Stmts.push_back (new WhileStatement (Cond, WhileStmts));
+    Stmts.push_back (new WhileStatement (Loc, Cond, WhileStmts));
+}
+
+/**
+ * Handles the header of a for statement, before its body is parsed.
+ *
+ * The control variable must be a local INTEGER variable, and the bounds must
+ * be convertible to INTEGER. The step defaults to 1 and must be a constant, since it decides
+ * whether the loop counts up or down. Until the matching call with the body,
+ * the control variable may not be changed.
+ *
+ * @param Loc The source location of the for statement.
+ * @param D The declaration of the control variable.
+ * @param Start The initial value of the control variable.
+ * @param End The final value of the control variable.
+ * @param Step The optional step, or nullptr.
+ * @return The for statement without its body, or nullptr on error.
+ */
+ForStatement* Sema::actOnForStatement (llvm::SMLoc Loc, Decl* D, Expr* Start, Expr* End, Expr* Step) {
+    auto* Var = llvm::dyn_cast_or_null<VariableDecl> (D);
+    if (!Var || Var->getEnclosingDecl () != CurDecl || Var->getType () != IntegerType) {
+        Diag.report (Loc, diag::err_for_control_var_must_be_local_integer);
+        return nullptr;
+    }
+    Start = convertTo (Start, IntegerType);
+    End   = convertTo (End, IntegerType);
+    if (!Start || !End) {
+        Diag.report (Loc, diag::err_for_bounds_must_be_integer);
+        return nullptr;
+    }
+
+    int64_t StepValue = 1;
+    if (Step && (!evaluateConstant (Step, StepValue) || StepValue == 0)) {
+        Diag.report (Loc, diag::err_for_step_must_be_constant);
+        return nullptr;
+    }
+
+    // A nested FOR statement must not reuse the control variable either.
+    if (!ForControlVars.insert (Var).second) {
+        Diag.report (Loc, diag::err_for_control_var_changed, Var->getName ());
+        return nullptr;
+    }
+    return new ForStatement (Loc, Var, Start, End, StepValue);
+}
+
+/**
+ * Completes a for statement with its body and adds it to the list of statements.
+ *
+ * @param Stmts The list of statements to add the for statement to.
+ * @param For The for statement returned for the header, or nullptr.
+ * @param ForStmts The list of statements for the loop body.
+ */
+void Sema::actOnForStatement (StmtList& Stmts, ForStatement* For, StmtList& ForStmts) {
+    if (!For)
+        return;
+
+    ForControlVars.erase (For->getVar ());
+    For->setStmts (ForStmts);
+    Stmts.push_back (For);
 }
 
 /**
@@ -547,10 +996,69 @@ void Sema::actOnReturnStatement (StmtList& Stmts, llvm::SMLoc Loc, Expr* RetVal)
         Diag.report (Loc, diag::err_function_requires_return);
     if (!Cur->getRetType () && RetVal)
         Diag.report (Loc, diag::err_procedure_requires_empty_return);
-    if ((Cur->getRetType () && RetVal) && Cur->getRetType () != RetVal->getType ())
-        Diag.report (Loc, diag::err_function_and_return_type);
+    if (Cur->getRetType () && RetVal) {
+        if (Expr* Converted = convertTo (RetVal, Cur->getRetType ()))
+            RetVal = Converted;
+        else
+            Diag.report (Loc, diag::err_function_and_return_type);
+    }
+
+    Stmts.push_back (new ReturnStatement (Loc, RetVal));
+}
+
+/**
+ * Handles the action of a raise statement.
+ *
+ * @param Stmts The list of statements to add the raise statement to.
+ * @param Loc The source location of the raise statement.
+ * @param D The declaration of the raised exception.
+ */
+void Sema::actOnRaiseStatement (StmtList& Stmts, llvm::SMLoc Loc, Decl* D) {
+    if (auto* Exc = llvm::dyn_cast_or_null<ExceptionDecl> (D))
+        Stmts.push_back (new RaiseStatement (Loc, Exc));
+    else
+        Diag.report (Loc, diag::err_raise_requires_exception);
+}
+
+/**
+ * Handles one handler of a try statement. Each exception may only be
+ * handled once per try statement.
+ *
+ * @param Handlers The handlers of the try statement parsed so far.
+ * @param Loc The source location of the handler.
+ * @param D The declaration of the handled exception.
+ * @param HandlerStmts The list of statements run for the exception.
+ */
+void Sema::actOnExceptHandler (HandlerList& Handlers, llvm::SMLoc Loc, Decl* D, StmtList& HandlerStmts) {
+    auto* Exc = llvm::dyn_cast_or_null<ExceptionDecl> (D);
+    if (!Exc) {
+        Diag.report (Loc, diag::err_handler_requires_exception);
+        return;
+    }
+    if (llvm::any_of (Handlers, [Exc] (const ExceptHandler& H) { return H.Exc == Exc; })) {
+        Diag.report (Loc, diag::err_exception_already_handled, Exc->getName ());
+        return;
+    }
+    Handlers.push_back ({ Exc, HandlerStmts });
+}
 
-    Stmts.push_back (new ReturnStatement (RetVal));
+/**
+ * Handles the action of a try statement.
+ *
+ * @param Stmts The list of statements to add the try statement to.
+ * @param Loc The source location of the try statement.
+ * @param TryStmts The list of statements whose exceptions are handled.
+ * @param Handlers The handlers, checked by actOnExceptHandler.
+ * @param ElseStmts The list of statements run for every other exception.
+ * @param HasElse Whether there is an ELSE part, which may be empty.
+ */
+void Sema::actOnTryStatement (StmtList& Stmts,
+llvm::SMLoc Loc,
+StmtList& TryStmts,
+HandlerList& Handlers,
+StmtList& ElseStmts,
+bool HasElse) {
+    Stmts.push_back (new TryStatement (Loc, TryStmts, Handlers, ElseStmts, HasElse));
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -576,7 +1084,7 @@ Expr* Sema::actOnExpression (Expr* Left, Expr* Right, const OperatorInfo& Op) {
     if (!Left || !Right)
         return Left ?: Right;
 
-    if (Left->getType () != Right->getType ()) {
+    if (!convertOperands (Left, Right)) {
         Diag.report (Op.getLocation (), diag::err_types_for_operator_not_compatible,
         tok::getPunctuatorSpelling (Op.getKind ()));
     }
@@ -602,7 +1110,7 @@ Expr* Sema::actOnSimpleExpression (Expr* Left, Expr* Right, const OperatorInfo&
     if (!Left || !Right)
         return Left ?: Right;
 
-    if (Left->getType () != Right->getType ()) {
+    if (!convertOperands (Left, Right) || !isOperatorForType (Op.getKind (), Left->getType ())) {
         Diag.report (Op.getLocation (), diag::err_types_for_operator_not_compatible,
         tok::getPunctuatorSpelling (Op.getKind ()));
     }
@@ -611,11 +1119,13 @@ Expr* Sema::actOnSimpleExpression (Expr* Left, Expr* Right, const OperatorInfo&
     if (IsConst && Op.getKind () == tok::kw_OR) {
         BooleanLiteral* L = llvm::dyn_cast<BooleanLiteral> (Left);
         BooleanLiteral* R = llvm::dyn_cast<BooleanLiteral> (Right);
-        return L->getValue () || R->getValue () ? TrueLiteral : FalseLiteral;
+        if (L && R)
+            return L->getValue () || R->getValue () ? TrueLiteral : FalseLiteral;
     }
 
-    return new InfixExpression (
-    Left, Right, Op, BooleanType, Left->isConst () && Right->isConst ());
+    // `+` and `-` yield the common type of their operands.
+    TypeDecl* Ty = Op.getKind () == tok::kw_OR ? BooleanType : Left->getType ();
+    return new InfixExpression (Left, Right, Op, Ty, Left->isConst () && Right->isConst ());
 }
 
 /**
@@ -635,7 +1145,7 @@ Expr* Sema::actOnTerm (Expr* Left, Expr* Right, const OperatorInfo& Op) {
     if (!Left || !Right)
         return Left ?: Right;
 
-    if (Left->getType () != Right->getType ()) {
+    if (!convertOperands (Left, Right) || !isOperatorForType (Op.getKind (), Left->getType ())) {
         Diag.report (Op.getLocation (), diag::err_types_for_operator_not_compatible,
         tok::getPunctuatorSpelling (Op.getKind ()));
     }
@@ -644,11 +1154,13 @@ Expr* Sema::actOnTerm (Expr* Left, Expr* Right, const OperatorInfo& Op) {
     if (IsConst && Op.getKind () == tok::kw_AND) {
         BooleanLiteral* L = llvm::dyn_cast<BooleanLiteral> (Left);
         BooleanLiteral* R = llvm::dyn_cast<BooleanLiteral> (Right);
-        return L->getValue () || R->getValue () ? TrueLiteral : FalseLiteral;
+        if (L && R)
+            return L->getValue () && R->getValue () ? TrueLiteral : FalseLiteral;
     }
 
-    return new InfixExpression (
-    Left, Right, Op, BooleanType, Left->isConst () && Right->isConst ());
+    // `*`, `/`, DIV and MOD yield the common type of their operands.
+    TypeDecl* Ty = Op.getKind () == tok::kw_AND ? BooleanType : Left->getType ();
+    return new InfixExpression (Left, Right, Op, Ty, Left->isConst () && Right->isConst ());
 }
 
 /**
@@ -691,13 +1203,19 @@ Expr* Sema::actOnTerm (Expr* Left, Expr* Right, const OperatorInfo& Op) {
 Expr* Sema::actOnPrefixExpression (Expr* E, const OperatorInfo& Op) {
     if (!E)
         return nullptr;
-    if (E->isConst ())
-        return llvm::dyn_cast<BooleanLiteral> (E)->getValue () ? TrueLiteral : FalseLiteral;
+    if (auto* Lit = llvm::dyn_cast<BooleanLiteral> (E); Lit && Op.getKind () == tok::kw_NOT)
+        return Lit->getValue () ? FalseLiteral : TrueLiteral;
+
+    // CARDINAL has no negative values.
+    PervasiveTypeDecl* IntTy = getIntegerType (E->getType ());
+    if (Op.getKind () == tok::minus && IntTy && !IntTy->isSigned ())
+        Diag.report (Op.getLocation (), diag::err_types_for_operator_not_compatible,
+        tok::getPunctuatorSpelling (Op.getKind ()));
 
     if (Op.getKind () == tok::TokenKind::minus) {
         bool Ambigious = true;
         if (llvm::isa<Designator> (E) || llvm::isa<ConstantAccess> (E) ||
-        llvm::isa<IntegerLiteral> (E))
+        llvm::isa<IntegerLiteral> (E) || llvm::isa<RealLiteral> (E))
             Ambigious = false;
         if (auto Infix = llvm::dyn_cast<InfixExpression> (E)) {
             auto OpKind = Infix->getOperatorInfo ().getKind ();
@@ -737,7 +1255,25 @@ Expr* Sema::actOnIntegerLiteral (llvm::SMLoc Loc, llvm::StringRef Literal) {
     }
 
     llvm::APInt Value (64, Literal, Radix);
-    return new IntegerLiteral (Loc, llvm::APSInt (Value), IntegerType);
+    return new IntegerLiteral (Loc, llvm::APSInt (Value, false), IntegerType);
+}
+
+/**
+ * Parses a real literal and returns a `RealLiteral` expression of type
+ * LONGREAL. Where a REAL is expected, it is rounded to REAL, see convertTo.
+ *
+ * @param Loc The source location of the real literal.
+ * @param Literal The string representation of the real literal.
+ * @return A `RealLiteral` expression representing the parsed value.
+ * @example `1.5`, `6.02E23`, `1.0E-9`
+ */
+Expr* Sema::actOnRealLiteral (llvm::SMLoc Loc, llvm::StringRef Literal) {
+    llvm::APFloat Value (llvm::APFloat::IEEEdouble ());
+    // The lexer only forms literals in a valid format.
+    auto Status = llvm::cantFail (Value.convertFromString (Literal, llvm::APFloat::rmNearestTiesToEven));
+    if (Status & llvm::APFloat::opOverflow)
+        Diag.report (Loc, diag::err_real_literal_too_large, Literal);
+    return new RealLiteral (Loc, Value, LongRealType);
 }
 
 /**
@@ -789,6 +1325,10 @@ Expr* Sema::actOnIntegerLiteral (llvm::SMLoc Loc, llvm::StringRef Literal) {
 Expr* Sema::actOnFunctionCall (Decl* D, ExprList& Params) {
     if (!D)
         return nullptr;
+    if (auto* Ty = llvm::dyn_cast<TypeDecl> (D); getIntegerType (Ty) || getRealType (Ty))
+        return actOnConversion (Ty, Params);
+    if (D == HighProc)
+        return actOnHigh (D->getLocation (), Params);
     if (auto* P = llvm::dyn_cast<ProcedureDecl> (D)) {
         checkFormalAndActualParameters (D->getLocation (), P->getFormalParams (), Params);
         if (!P->getRetType ())
@@ -799,6 +1339,65 @@ Expr* Sema::actOnFunctionCall (Decl* D, ExprList& Params) {
     return nullptr;
 }
 
+/**
+ * Handles an explicit conversion to an integer or real type, which is written
+ * like a function call. Unlike an implicit conversion, it may narrow the value
+ * or change its signedness; an integer wraps around. A real converted to an
+ * integer is truncated toward zero and must fit into the integer type.
+ *
+ * @param Ty The integer or real type to convert to.
+ * @param Params The arguments, which must be a single integer or real expression.
+ * @return The converted expression, or nullptr on error.
+ * @example `INT8 (i)`, `CARDINAL (i)`, `INTEGER (c)`, `REAL (i)`, `INTEGER (x)`
+ */
+Expr* Sema::actOnConversion (TypeDecl* Ty, ExprList& Params) {
+    TypeDecl* ArgTy = Params.size () == 1 && Params.front () ? Params.front ()->getType () : nullptr;
+    if (!getIntegerType (ArgTy) && !getRealType (ArgTy)) {
+        Diag.report (Ty->getLocation (), diag::err_conversion_requires_number, Ty->getName ());
+        return nullptr;
+    }
+
+    Expr* E = Params.front ();
+    if (E->getType () == Ty)
+        return E;
+    if (getRealType (Ty))
+        if (RealLiteral* Lit = foldReal (E, Ty))
+            return Lit;
+    if (auto* Lit = llvm::dyn_cast<IntegerLiteral> (E); Lit && getIntegerType (Ty)) {
+        PervasiveTypeDecl* To = getIntegerType (Ty);
+        llvm::APSInt Value    = Lit->getValue ().extOrTrunc (To->getBitWidth ());
+        Value.setIsSigned (To->isSigned ());
+        return new IntegerLiteral (Lit->getLocation (), Value, Ty);
+    }
+    return new ConversionExpr (E, Ty);
+}
+
+/**
+ * Handles the pervasive function HIGH, the index of the last element of an
+ * array. It is folded for an array of fixed length; for an open array
+ * parameter, it is computed from the length passed along.
+ *
+ * @param Loc The source location of the call.
+ * @param Params The arguments, which must be a single array variable.
+ * @return The index as INTEGER, or nullptr on error.
+ * @example `FOR i := 0 TO HIGH (a) DO s := s + a[i] END`
+ */
+Expr* Sema::actOnHigh (llvm::SMLoc Loc, ExprList& Params) {
+    auto* Desig = Params.size () == 1 ? llvm::dyn_cast<Designator> (Params.front ()) : nullptr;
+    if (Desig) {
+        int64_t Nums;
+        if (auto* Arr = llvm::dyn_cast<ArrayTypeDecl> (Desig->getType ());
+            Arr && evaluateConstant (Arr->getNums (), Nums))
+            return new IntegerLiteral (Loc, llvm::APSInt (llvm::APInt (64, Nums - 1, true), false), IntegerType);
+
+        auto* FP = llvm::dyn_cast<FormalParameterDecl> (Desig->getDecl ());
+        if (FP && FP->isOpenArray () && Desig->getSelectors ().empty ())
+            return new HighExpr (FP, IntegerType);
+    }
+    Diag.report (Loc, diag::err_high_requires_array);
+    return nullptr;
+}
+
 /**
  * @brief Handles a qualified identifier part during name lookup.
  *
@@ -855,11 +1454,110 @@ Expr* Sema::actOnDesignator (Decl* D) {
         if (C == FalseConst) {
             return FalseLiteral;
         }
+        if (llvm::isa_and_nonnull<AggregateLiteral> (C->getExpr ()))
+            return new Designator (C);
         return new ConstantAccess (C);
     }
     return nullptr;
 }
 
+/**
+ * Handles a structured constant of the given type.
+ *
+ * `ARRAY OF T {...}` is an array of T with as many components as there are
+ * elements. Without a type, as inside another structured constant, the
+ * aggregate is typed later by the enclosing one.
+ *
+ * @param Loc The source location of the aggregate.
+ * @param D The type of the aggregate, or nullptr for a nested one.
+ * @param Elements The elements, in the order of the components or fields.
+ * @return The aggregate, or nullptr on error.
+ * @example `CONST Primes = ARRAY OF INTEGER {2, 3, 5, 7};`
+ */
+Expr* Sema::actOnAggregate (llvm::SMLoc Loc, Decl* D, ExprList& Elements) {
+    auto* Agg = new AggregateLiteral (Loc, Elements);
+    if (!D)
+        return Agg;
+
+    auto* Ty = llvm::dyn_cast<TypeDecl> (D);
+    if (auto* Open = llvm::dyn_cast_or_null<OpenArrayTypeDecl> (Ty)) {
+        llvm::APSInt Nums (llvm::APInt (64, Elements.size ()), false);
+        Ty = new ArrayTypeDecl (CurDecl, Loc, Open->getName (),
+        new IntegerLiteral (Loc, Nums, IntegerType), Open->getType ());
+    }
+    if (!Ty) {
+        Diag.report (Loc, diag::err_aggregate_requires_structured_type);
+        return nullptr;
+    }
+    return checkAggregate (Agg, Ty) ? Agg : nullptr;
+}
+
+/**
+ * Checks a structured constant against its type.
+ *
+ * An array takes one element per component, a record one per field in
+ * declaration order. Each scalar element must be a constant of its type, and
+ * is folded into a literal, so CodeGen can emit the whole aggregate as the
+ * initializer of a constant.
+ *
+ * @param Agg The aggregate to check.
+ * @param Ty The type the aggregate is used as.
+ * @return `true` if the aggregate is valid, `false` otherwise.
+ */
+bool Sema::checkAggregate (AggregateLiteral* Agg, TypeDecl* Ty) {
+    llvm::SmallVector<TypeDecl*, 8> Types;
+    int64_t Nums;
+    if (auto* Arr = llvm::dyn_cast<ArrayTypeDecl> (Ty); Arr && evaluateConstant (Arr->getNums (), Nums))
+        Types.assign (Nums, Arr->getType ());
+    else if (auto* Rec = llvm::dyn_cast<RecordTypeDecl> (Ty))
+        for (const auto& F : Rec->getFields ())
+            Types.push_back (F.getType ());
+    else {
+        Diag.report (Agg->getLocation (), diag::err_aggregate_requires_structured_type);
+        return false;
+    }
+
+    ExprList& Elements = Agg->getElements ();
+    if (Elements.size () != Types.size ()) {
+        Diag.report (Agg->getLocation (), diag::err_aggregate_wrong_number_of_elements,
+        Ty->getName (), Types.size ());
+        return false;
+    }
+
+    Agg->setType (Ty);
+    for (size_t I = 0, E = Elements.size (); I != E; ++I) {
+        if (auto* Nested = llvm::dyn_cast_or_null<AggregateLiteral> (Elements[I])) {
+            if (!checkAggregate (Nested, Types[I]))
+                return false;
+            continue;
+        }
+        Expr* Folded = foldElement (Elements[I], Types[I]);
+        if (!Folded) {
+            Diag.report (Agg->getLocation (), diag::err_aggregate_element_not_constant, Types[I]->getName ());
+            return false;
+        }
+        Elements[I] = Folded;
+    }
+    return true;
+}
+
+// Folds a scalar element of a structured constant into a literal of its type.
+Expr* Sema::foldElement (Expr* E, TypeDecl* Ty) {
+    while (auto* Const = llvm::dyn_cast_or_null<ConstantAccess> (E))
+        E = Const->geDecl ()->getExpr ();
+    if (Ty == BooleanType)
+        return llvm::isa_and_nonnull<BooleanLiteral> (E) ? E : nullptr;
+    if (getRealType (Ty))
+        return foldReal (E, Ty);
+
+    PervasiveTypeDecl* IntTy = getIntegerType (Ty);
+    int64_t Value;
+    if (!IntTy || !E || !E->isConst () || !evaluateConstant (E, Value) || !convertTo (E, Ty))
+        return nullptr;
+    llvm::APSInt V (llvm::APInt (IntTy->getBitWidth (), Value, IntTy->isSigned ()), !IntTy->isSigned ());
+    return new IntegerLiteral (llvm::SMLoc (), V, Ty);
+}
+
 // Each Selectors below just adds its self to designator (one)
 
 /**
@@ -876,8 +1574,14 @@ void Sema::actOnIndexSelector (Expr* Desig, llvm::SMLoc Loc, Expr* E) {
     if (auto* D = llvm::dyn_cast<Designator> (Desig)) {
         if (auto* Ty = llvm::dyn_cast<ArrayTypeDecl> (D->getType ())) {
             D->addSelector (new IndexSelector (Ty->getType (), E));
+            return;
+        }
+        if (auto* Ty = llvm::dyn_cast<OpenArrayTypeDecl> (D->getType ())) {
+            D->addSelector (new IndexSelector (Ty->getType (), E));
+            return;
         }
         Diag.report (Loc, diag::err_expected); // change name
+        return;
     }
     Diag.report (Loc, diag::err_expected); // change name
 }
@@ -0,0 +1,186 @@
+#include "aman_rt.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Runtime support for programs compiled by amanlang. Link the object files
+ * with libAmanRT.a.
+ */
+
+/*
+ * Called from the cold failure block of a procedure when a runtime check
+ * (-fbounds-check, -fdiv-check, CASE without ELSE) fails. The site ID is `Line << 4 | Kind`,
+ * see CGProcedure::CheckKind.
+ */
+__attribute__ ((noreturn, cold)) void __aman_check_failed (unsigned Site) {
+    const char* What;
+    switch (Site & 0xf) {
+    case 1: What = "array index out of bounds"; break;
+    case 2: What = "division by zero"; break;
+    case 3: What = "no CASE label matches"; break;
+    default: What = "runtime check failed"; break;
+    }
+    fprintf (stderr, "aman: %s at line %u\n", What, Site >> 4);
+    abort ();
+}
+
+/*
+ * The heap behind NEW and DISPOSE.
+ *
+ * Small objects, up to 512 bytes, come from 32 size classes of 16 byte
+ * granules. Each thread carves them out of its own 64 KiB slabs with a bump
+ * pointer and keeps a free list per class, so neither path takes a lock.
+ * DISPOSE passes the size again, therefore objects carry no header; the
+ * compiler knows the size from the pointer type. Larger objects go to
+ * aligned_alloc with a 16 byte header.
+ *
+ * An object must be disposed on the thread that allocated it.
+ */
+
+#define GRANULE     16
+#define NUM_CLASSES 32
+#define MAX_SMALL   (GRANULE * NUM_CLASSES)
+#define SLAB_SIZE   (64 * 1024)
+
+struct FreeObj {
+    struct FreeObj* Next;
+};
+
+struct Arena;
+
+/* Slabs are aligned to their size, so an object finds its slab by masking. */
+struct Slab {
+    struct Slab* Next;
+    struct Arena* Owner;
+};
+
+struct LargeObj {
+    struct LargeObj* Next;
+    struct Arena* Owner;
+};
+
+struct Arena {
+    struct FreeObj* Free[NUM_CLASSES];
+    char* Bump;
+    char* End;
+    struct Slab* Slabs;
+    struct LargeObj* Large; /* Only tracked in regions */
+    struct Arena* Prev;     /* Enclosing region or the thread's heap */
+    int IsRegion;
+};
+
+static _Thread_local struct Arena ThreadHeap;
+static _Thread_local struct Arena* Cur;
+
+static __attribute__ ((noreturn, cold)) void outOfMemory (uint64_t Size) {
+    fprintf (stderr, "aman: out of memory allocating %llu bytes\n", (unsigned long long)Size);
+    abort ();
+}
+
+static struct Arena* current (void) {
+    if (!Cur)
+        Cur = &ThreadHeap;
+    return Cur;
+}
+
+static unsigned sizeClass (uint64_t Size) {
+    return Size ? (unsigned)((Size - 1) / GRANULE) : 0;
+}
+
+static __attribute__ ((noinline)) void* refill (struct Arena* A, uint64_t Size) {
+    struct Slab* S = aligned_alloc (SLAB_SIZE, SLAB_SIZE);
+    if (!S)
+        outOfMemory (Size);
+    S->Next  = A->Slabs;
+    S->Owner = A;
+    A->Slabs = S;
+    A->Bump  = (char*)S + sizeof (struct Slab) + Size;
+    A->End   = (char*)S + SLAB_SIZE;
+    return (char*)S + sizeof (struct Slab);
+}
+
+static __attribute__ ((noinline)) void* allocLarge (struct Arena* A, uint64_t Size) {
+    if (Size > SIZE_MAX - 2 * sizeof (struct LargeObj))
+        outOfMemory (Size);
+    size_t Bytes = (sizeof (struct LargeObj) + Size + GRANULE - 1) & ~(size_t)(GRANULE - 1);
+    struct LargeObj* L = aligned_alloc (GRANULE, Bytes);
+    if (!L)
+        outOfMemory (Size);
+    L->Owner = A;
+    L->Next  = NULL;
+    if (A->IsRegion) {
+        L->Next  = A->Large;
+        A->Large = L;
+    }
+    return L + 1;
+}
+
+void* __aman_new (uint64_t Size) {
+    struct Arena* A = current ();
+    if (Size > MAX_SMALL)
+        return allocLarge (A, Size);
+
+    unsigned Class      = sizeClass (Size);
+    struct FreeObj* Obj = A->Free[Class];
+    if (Obj) {
+        A->Free[Class] = Obj->Next;
+        return Obj;
+    }
+
+    uint64_t Rounded = (uint64_t)(Class + 1) * GRANULE;
+    if ((uint64_t)(A->End - A->Bump) < Rounded)
+        return refill (A, Rounded);
+    void* Mem = A->Bump;
+    A->Bump += Rounded;
+    return Mem;
+}
+
+void __aman_dispose (void* Ptr, uint64_t Size) {
+    if (!Ptr)
+        return;
+
+    if (Size > MAX_SMALL) {
+        struct LargeObj* L = (struct LargeObj*)Ptr - 1;
+        /* Region objects are released with their region. */
+        if (!L->Owner->IsRegion)
+            free (L);
+        return;
+    }
+
+    struct Slab* S      = (struct Slab*)((uintptr_t)Ptr & ~(uintptr_t)(SLAB_SIZE - 1));
+    struct FreeObj* Obj = Ptr;
+    unsigned Class      = sizeClass (Size);
+    Obj->Next           = S->Owner->Free[Class];
+    S->Owner->Free[Class] = Obj;
+}
+
+void aman_region_begin (void) {
+    struct Arena* R = calloc (1, sizeof (struct Arena));
+    if (!R)
+        outOfMemory (sizeof (struct Arena));
+    R->IsRegion = 1;
+    R->Prev     = current ();
+    Cur         = R;
+}
+
+void aman_region_end (void) {
+    struct Arena* R = current ();
+    if (!R->IsRegion) {
+        fprintf (stderr, "aman: aman_region_end without aman_region_begin\n");
+        abort ();
+    }
+
+    for (struct Slab* S = R->Slabs; S;) {
+        struct Slab* Next = S->Next;
+        free (S);
+        S = Next;
+    }
+    for (struct LargeObj* L = R->Large; L;) {
+        struct LargeObj* Next = L->Next;
+        free (L);
+        L = Next;
+    }
+    Cur = R->Prev;
+    free (R);
+}
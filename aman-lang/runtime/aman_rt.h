@@ -0,0 +1,37 @@
+#ifndef AMAN_RT_H
+#define AMAN_RT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Entry points of the runtime library. The `__aman_` functions are called by
+ * generated code; the others may be called from C code linked into a program.
+ */
+
+/* Reports a failed runtime check and aborts. */
+__attribute__ ((noreturn, cold)) void __aman_check_failed (unsigned Site);
+
+/* Backs NEW: returns Size uninitialized bytes, aligned to 16. Never fails. */
+void* __aman_new (uint64_t Size);
+
+/* Backs DISPOSE: Size must be the size passed to __aman_new. NULL is ignored. */
+void __aman_dispose (void* Ptr, uint64_t Size);
+
+/*
+ * Regions: between aman_region_begin and the matching aman_region_end, NEW
+ * allocates from a fresh arena of the calling thread, and aman_region_end
+ * releases all of it at once. Regions nest. Objects of a region must not be
+ * used after its end.
+ */
+void aman_region_begin (void);
+void aman_region_end (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AMAN_RT_H */
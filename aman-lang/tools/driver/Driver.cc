@@ -33,6 +33,23 @@
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/PGOOptions.h"
+#include "llvm/Support/VirtualFileSystem.h"
+
+// Parallel codegen
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+
+// LTO
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/LTO/LTO.h"
+#include "llvm/Support/Caching.h"
 
 
 using namespace llvm;
@@ -50,11 +67,11 @@ static llvm::cl::opt<std::string> MTriple ("mtriple", llvm::cl::desc ("Override
 // Option for Emiting IR (default:false)
 static llvm::cl::opt<bool> EmitIR ("emitir", llvm::cl::desc ("emit"), llvm::cl::init (false));
 
-// Input file
-static llvm::cl::opt<std::string> InputFile (
+// Input files
+static llvm::cl::list<std::string> InputFiles (
 llvm::cl::Positional, // Position == no '-' required so can do ./amanlang test.lang
 llvm::cl::desc ("<input-files>"),
-llvm::cl::init ("-"));
+llvm::cl::OneOrMore);
 
 // Option for output file name
 static llvm::cl::opt<std::string>
@@ -81,6 +98,37 @@ clEnumValN (-1,
 clEnumValN (-2, "Oz", "Like -Os but reduces code size further")),
 cl::init (0));
 
+// Instrumented profile-guided optimization
+static cl::opt<std::string> ProfileGenerate ("fprofile-generate",
+cl::ValueOptional,
+cl::value_desc ("file"),
+cl::desc ("Instrument the program to write an execution profile (default: default_%m.profraw)"));
+static cl::opt<std::string> ProfileUse ("fprofile-use",
+cl::value_desc ("file.profdata"),
+cl::desc ("Optimize with an execution profile merged by llvm-profdata"));
+
+// Link-time optimization
+enum LTOKind { LTO_None, LTO_Thin, LTO_Full };
+static cl::opt<LTOKind> LTOMode ("flto",
+cl::desc ("Emit bitcode for link-time optimization instead of native code"),
+cl::ValueOptional,
+cl::values (clEnumValN (LTO_Full, "", "Same as -flto=full"),
+clEnumValN (LTO_Thin, "thin", "Bitcode with a module summary, for ThinLTO"),
+clEnumValN (LTO_Full, "full", "Bitcode for merging all modules into one")),
+cl::init (LTO_None));
+static cl::opt<bool> LTOLink ("lto-link",
+cl::desc ("Link bitcode compiled with -flto into one relocatable object"));
+static cl::opt<unsigned> LTOJobs ("lto-jobs",
+cl::desc ("Number of threads for the ThinLTO and parallel codegen backends (0 = all cores)"),
+cl::init (0));
+
+static cl::opt<unsigned> ParallelCodeGen ("parallel-codegen",
+cl::desc ("Split the optimized module and run the backend on N threads"),
+cl::init (1));
+
+static cl::opt<bool> SplitDwarf ("gsplit-dwarf",
+cl::desc ("Write the bulk of the debug info into a .dwo file next to the object file"));
+
 
 // The plugin mechanism of LLVM supports a plugin registry for statically linked plugins
 // getPProfilerPluginInfo()
@@ -109,9 +157,9 @@ std::string outputFilename (StringRef InputFilename) {
         else
             OutputFilename = InputFilename.str ();
         switch (FileType) {
-        case llvm::CodeGenFileType::AssemblyFile: OutputName.append (EmitIR ? ".ll" : ".s"); break;
-        case llvm::CodeGenFileType::ObjectFile: OutputName.append (".o"); break;
-        case llvm::CodeGenFileType::Null: OutputName.append (".null"); break;
+        case llvm::CodeGenFileType::AssemblyFile: OutputFilename.append (EmitIR ? ".ll" : ".s"); break;
+        case llvm::CodeGenFileType::ObjectFile: OutputFilename.append (".o"); break;
+        case llvm::CodeGenFileType::Null: OutputFilename.append (".null"); break;
         }
     }
     return OutputFilename;
@@ -122,6 +170,8 @@ std::string outputFilename (StringRef InputFilename) {
 #pragma mark - Target Machine
 ////////////////////////////////////////////////////////////////////////////////
 
+llvm::TargetMachine* createTarget ();
+
 // With the target machine instance,
 // We can generate IR code that targets a CPU architecture of our choice.
 llvm::TargetMachine* createTarget () {
@@ -144,13 +194,149 @@ llvm::TargetMachine* createTarget () {
     return TM;
 }
 
+bool combineObjects (llvm::StringRef Argv0, llvm::ArrayRef<llvm::SmallString<0>> Objects, llvm::StringRef OutputFilename);
+
+// Same approach as LTO's parallel codegen: SplitModule partitions the
+// optimized module, and every partition runs through instruction selection on
+// its own thread, with its own LLVMContext and TargetMachine. The partitions
+// travel between contexts as bitcode. The resulting objects are combined with
+// a relocatable link (`ld -r`).
+bool emitParallel (llvm::StringRef Argv0, llvm::Module& M, llvm::StringRef OutputFilename) {
+    llvm::SmallVector<llvm::SmallString<0>, 8> Parts;
+    llvm::SplitModule (M, ParallelCodeGen, [&] (std::unique_ptr<llvm::Module> MPart) {
+        llvm::raw_svector_ostream OS (Parts.emplace_back ());
+        llvm::WriteBitcodeToFile (*MPart, OS);
+    });
+
+    std::vector<llvm::SmallString<0>> Objects (Parts.size ());
+    std::vector<std::string> Errors (Parts.size ());
+    {
+        llvm::DefaultThreadPool Pool (llvm::hardware_concurrency (ParallelCodeGen));
+        for (size_t I = 0, E = Parts.size (); I != E; ++I) {
+            Pool.async ([&, I] {
+                llvm::LLVMContext Ctx;
+                auto MPart = llvm::parseBitcodeFile (
+                llvm::MemoryBufferRef (Parts[I].str (), M.getName ()), Ctx);
+                if (!MPart) {
+                    Errors[I] = toString (MPart.takeError ());
+                    return;
+                }
+
+                std::unique_ptr<llvm::TargetMachine> TM (createTarget ());
+                if (!TM) {
+                    Errors[I] = "could not create target";
+                    return;
+                }
+
+                llvm::raw_svector_ostream OS (Objects[I]);
+                llvm::legacy::PassManager PM;
+                PM.add (createTargetTransformInfoWrapperPass (TM->getTargetIRAnalysis ()));
+                if (TM->addPassesToEmitFile (PM, OS, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+                    Errors[I] = "target does not support object file emission";
+                    return;
+                }
+                PM.run (**MPart);
+            });
+        }
+        Pool.wait ();
+    }
+
+    for (const std::string& Err : Errors) {
+        if (!Err.empty ()) {
+            llvm::WithColor::error (llvm::errs (), Argv0) << Err << '\n';
+            return false;
+        }
+    }
+    return combineObjects (Argv0, Objects, OutputFilename);
+}
+
+// Writes the objects to temporaries and combines them into one relocatable
+// object with `ld -r`. A single object is written out as is.
+bool combineObjects (llvm::StringRef Argv0, llvm::ArrayRef<llvm::SmallString<0>> Objects, llvm::StringRef OutputFilename) {
+    if (Objects.size () == 1) {
+        std::error_code EC;
+        llvm::ToolOutputFile Out (OutputFilename, EC, llvm::sys::fs::OF_None);
+        if (EC) {
+            llvm::WithColor::error (llvm::errs (), Argv0) << EC.message () << '\n';
+            return false;
+        }
+        Out.os () << Objects.front ();
+        Out.keep ();
+        return true;
+    }
+
+    llvm::SmallVector<llvm::SmallString<128>, 8> PartFiles (Objects.size ());
+    std::vector<std::unique_ptr<llvm::FileRemover>> Removers;
+    for (size_t I = 0, E = Objects.size (); I != E; ++I) {
+        int FD;
+        if (std::error_code EC =
+            llvm::sys::fs::createTemporaryFile ("amanlang-part", "o", FD, PartFiles[I])) {
+            llvm::WithColor::error (llvm::errs (), Argv0) << EC.message () << '\n';
+            return false;
+        }
+        Removers.push_back (std::make_unique<llvm::FileRemover> (PartFiles[I]));
+        llvm::raw_fd_ostream OS (FD, /*shouldClose=*/true);
+        OS << Objects[I];
+    }
+
+    auto Ld = llvm::sys::findProgramByName ("ld");
+    if (!Ld) {
+        llvm::WithColor::error (llvm::errs (), Argv0) << "'ld' is needed to combine the partitions\n";
+        return false;
+    }
+
+    llvm::SmallVector<llvm::StringRef, 16> Args{ *Ld, "-r", "-o", OutputFilename };
+    for (const auto& File : PartFiles)
+        Args.push_back (File);
+
+    std::string ErrMsg;
+    if (llvm::sys::ExecuteAndWait (*Ld, Args, std::nullopt, {}, 0, 0, &ErrMsg) != 0) {
+        llvm::WithColor::error (llvm::errs (), Argv0) << "ld -r failed: " << ErrMsg << '\n';
+        return false;
+    }
+    return true;
+}
+
+llvm::OptimizationLevel getOptimizationLevel () {
+    switch (Optimization) {
+    case 1: return llvm::OptimizationLevel::O1;
+    case 2: return llvm::OptimizationLevel::O2;
+    case 3: return llvm::OptimizationLevel::O3;
+    case -1: return llvm::OptimizationLevel::Os;
+    case -2: return llvm::OptimizationLevel::Oz;
+    default: return llvm::OptimizationLevel::O0;
+    }
+}
+
+// The PassBuilder adds PGOInstrumentationGen and the InstrProfiling lowering
+// to the default pipelines for IRInstr, and attaches the profile's branch
+// weights and function entry counts for IRUse.
+std::optional<llvm::PGOOptions> getPGOOptions () {
+    auto FS = llvm::vfs::getRealFileSystem ();
+    if (ProfileGenerate.getNumOccurrences ()) {
+        std::string File = ProfileGenerate.empty () ? "default_%m.profraw" : ProfileGenerate.getValue ();
+        return llvm::PGOOptions (File, "", "", "", FS, llvm::PGOOptions::IRInstr);
+    }
+    if (!ProfileUse.empty ())
+        return llvm::PGOOptions (ProfileUse, "", "", "", FS, llvm::PGOOptions::IRUse);
+    return std::nullopt;
+}
+
 bool emit (llvm::StringRef Argv0, llvm::Module* M, llvm::TargetMachine* TM, llvm::StringRef InputFilename) {
     llvm::CodeGenFileType FileType = llvm::codegen::getFileType ();
 
 
     ////////////////////////////////// CH.6 IR-Optimization START //////////////////////////////////
 
-    llvm::PassBuilder PB (TM);
+    std::optional<llvm::PGOOptions> PGOOpt = getPGOOptions ();
+    if (PGOOpt && PGOOpt->Action == llvm::PGOOptions::IRInstr) {
+        // The counters are global memory written by every procedure, which
+        // the memory effects computed from the source don't account for.
+        for (llvm::Function& F : *M)
+            F.removeFnAttr (llvm::Attribute::Memory);
+    }
+
+    llvm::PassBuilder PB (TM, llvm::PipelineTuningOptions (), PGOOpt);
 
     // loop through the list of plugin libraries given by the user
     // and try to load the opt plugin passed by ./amanlang --load-pass="pass1,pass2,..."
@@ -208,6 +394,13 @@ bool emit (llvm::StringRef Argv0, llvm::Module* M, llvm::TargetMachine* TM, llvm
             WithColor::error (errs (), Argv0) << toString (std::move (Err)) << "\n";
             return false;
         }
+    } else if (LTOMode != LTO_None) {
+        // Only the pre-link part of the pipeline runs on a single module; the
+        // rest runs across modules in --lto-link.
+        if (LTOMode == LTO_Thin)
+            MPM = PB.buildThinLTOPreLinkDefaultPipeline (getOptimizationLevel ());
+        else
+            MPM = PB.buildLTOPreLinkDefaultPipeline (getOptimizationLevel ());
     } else {
         StringRef DefaultPass;
         // User can pass in -01, -02, etc... but we default to -O0 in cl::init
@@ -227,18 +420,61 @@ bool emit (llvm::StringRef Argv0, llvm::Module* M, llvm::TargetMachine* TM, llvm
 
     ////////////////////////////////// CH.6 IR-Optimization END //////////////////////////////////
 
+    // -o names the output of the only input, see main; otherwise each module
+    // gets an output named after its source file.
+    std::string OutputFilename =
+    OutputName.getNumOccurrences () ? OutputName.getValue () : outputFilename (InputFilename);
+
+    // Only the skeleton compile unit goes into the object file, so the linker
+    // doesn't have to copy the debug info around.
+    bool EmitDwo = SplitDwarf && FileType == llvm::CodeGenFileType::ObjectFile &&
+    LTOMode == LTO_None && !EmitIR && M->getNamedMetadata ("llvm.dbg.cu");
+
+    // Assembly output stays on one thread: the partitions' local labels
+    // (.Lfunc_end0, ...) would clash when concatenated.
+    if (ParallelCodeGen > 1 && FileType == llvm::CodeGenFileType::ObjectFile &&
+    LTOMode == LTO_None && !EmitDwo) {
+        MPM.run (*M, MAM);
+        return emitParallel (Argv0, *M, OutputFilename);
+    }
+
     // Open output file (For windows needs carriage..)
     std::error_code ec;
     llvm::sys::fs::OpenFlags OpenFlags = llvm::sys::fs::OF_None;
     if (FileType == llvm::CodeGenFileType::AssemblyFile)
         OpenFlags |= llvm::sys::fs::OF_Text;
 
-    auto Out = std::make_unique<llvm::ToolOutputFile> (outputFilename (OutputName), ec, OpenFlags);
+    auto Out = std::make_unique<llvm::ToolOutputFile> (OutputFilename, ec, OpenFlags);
     if (ec) {
         llvm::WithColor::error (llvm::errs (), Argv0) << ec.message () << '\n';
         return false;
     }
 
+    // Like clang, both flavours carry a summary; full LTO marks the module
+    // so that the linker merges it instead of importing from it.
+    if (LTOMode != LTO_None) {
+        if (LTOMode == LTO_Full)
+            M->addModuleFlag (llvm::Module::Error, "ThinLTO", uint32_t (0));
+        MPM.addPass (llvm::BitcodeWriterPass (Out->os (), false, /*EmitSummaryIndex=*/true));
+        MPM.run (*M, MAM);
+        Out->keep ();
+        return true;
+    }
+
+
+    std::unique_ptr<llvm::ToolOutputFile> Dwo;
+    TM->Options.MCOptions.SplitDwarfFile.clear ();
+    if (EmitDwo) {
+        llvm::SmallString<128> DwoFilename (OutputFilename);
+        llvm::sys::path::replace_extension (DwoFilename, "dwo");
+        Dwo = std::make_unique<llvm::ToolOutputFile> (DwoFilename, ec, llvm::sys::fs::OF_None);
+        if (ec) {
+            llvm::WithColor::error (llvm::errs (), Argv0) << ec.message () << '\n';
+            return false;
+        }
+        // Recorded in the skeleton unit as DW_AT_dwo_name.
+        TM->Options.MCOptions.SplitDwarfFile = std::string (DwoFilename);
+    }
 
     llvm::legacy::PassManager PM;
     //// Per LLVM:
@@ -250,15 +486,91 @@ bool emit (llvm::StringRef Argv0, llvm::Module* M, llvm::TargetMachine* TM, llvm
     if (FileType == llvm::CodeGenFileType::AssemblyFile && EmitIR) {
         PM.add (llvm::createPrintModulePass (Out->os ()));
         PM.add (llvm::createPrintModulePass (llvm::outs ())); // own testing
+    } else if (TM->addPassesToEmitFile (PM, Out->os (), Dwo ? &Dwo->os () : nullptr, FileType)) {
+        llvm::WithColor::error (llvm::errs (), Argv0) << "No support for file type\n";
+        return false;
     }
 
     MPM.run (*M, MAM);
     PM.run (*M);  // Let the Pass Manager run
     Out->keep (); // dont delete file
+    if (Dwo)
+        Dwo->keep ();
 
     return true;
 }
 
+// The link step for modules compiled with -flto: ThinLTO imports and inlines
+// across modules using the summaries, then optimizes and code-generates each
+// module on its own thread; full LTO merges everything into one module and
+// splits it again for parallel codegen. The native objects are combined into
+// one relocatable object, which is linked like any other.
+bool ltoLink (llvm::StringRef Argv0, llvm::StringRef OutputFilename) {
+    llvm::Triple Triple = llvm::Triple (
+    !MTriple.empty () ? llvm::Triple::normalize (MTriple) : llvm::sys::getDefaultTargetTriple ());
+    auto Threads = llvm::heavyweight_hardware_concurrency (LTOJobs);
+
+    llvm::lto::Config Conf;
+    Conf.DefaultTriple = Triple.getTriple ();
+    Conf.CPU           = llvm::codegen::getCPUStr ();
+    Conf.MAttrs        = llvm::codegen::getMAttrs ();
+    Conf.Options       = llvm::codegen::InitTargetOptionsFromCodeGenFlags (Triple);
+    Conf.RelocModel    = llvm::codegen::getExplicitRelocModel ();
+    Conf.OptLevel      = Optimization < 0 ? 2 : Optimization;
+    Conf.PGOWarnMismatch = false;
+
+    llvm::lto::LTO Link (std::move (Conf),
+    llvm::lto::createInProcessThinBackend (Threads), Threads.compute_thread_count ());
+
+    // The buffers must outlive the link.
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> Buffers;
+    llvm::StringSet<> Defined;
+    for (const std::string& Filename : InputFiles) {
+        auto Buffer = llvm::MemoryBuffer::getFile (Filename);
+        if (!Buffer) {
+            llvm::WithColor::error (llvm::errs (), Argv0)
+            << "Error reading " << Filename << ": " << Buffer.getError ().message () << '\n';
+            return false;
+        }
+        auto Input = llvm::lto::InputFile::create ((*Buffer)->getMemBufferRef ());
+        if (!Input) {
+            llvm::WithColor::error (llvm::errs (), Argv0)
+            << Filename << ": " << toString (Input.takeError ()) << '\n';
+            return false;
+        }
+
+        // The result is linked with native code that may reference any
+        // symbol, so nothing is internalized. The first definition wins.
+        std::vector<llvm::lto::SymbolResolution> Resolutions;
+        for (const llvm::lto::InputFile::Symbol& Sym : (*Input)->symbols ()) {
+            llvm::lto::SymbolResolution Res;
+            Res.Prevailing          = !Sym.isUndefined () && Defined.insert (Sym.getName ()).second;
+            Res.VisibleToRegularObj = true;
+            Resolutions.push_back (Res);
+        }
+        if (llvm::Error Err = Link.add (std::move (*Input), Resolutions)) {
+            llvm::WithColor::error (llvm::errs (), Argv0)
+            << Filename << ": " << toString (std::move (Err)) << '\n';
+            return false;
+        }
+        Buffers.push_back (std::move (*Buffer));
+    }
+
+    // Each backend task writes into its own buffer.
+    std::vector<llvm::SmallString<0>> Objects (Link.getMaxTasks ());
+    auto AddStream = [&] (unsigned Task, const llvm::Twine&) -> llvm::Expected<std::unique_ptr<llvm::CachedFileStream>> {
+        return std::make_unique<llvm::CachedFileStream> (
+        std::make_unique<llvm::raw_svector_ostream> (Objects[Task]));
+    };
+    if (llvm::Error Err = Link.run (AddStream)) {
+        llvm::WithColor::error (llvm::errs (), Argv0) << toString (std::move (Err)) << '\n';
+        return false;
+    }
+
+    llvm::erase_if (Objects, [] (const llvm::SmallString<0>& Obj) { return Obj.empty (); });
+    return combineObjects (Argv0, Objects, OutputFilename);
+}
+
 // default cpu to host target
 void default_cpu () {
     auto atrs = llvm::codegen::getMAttrs ();
@@ -286,13 +598,8 @@ void default_cpu () {
 #pragma mark - Main
 ////////////////////////////////////////////////////////////////////////////////
 
-static llvm::codegen::RegisterCodeGenFlags CGF ();
-static cl::opt<CodeGenFileType> FileType ("filetype",
-cl::init (CodeGenFileType::AssemblyFile),
-cl::desc ("Choose a file type (not all types are supported by all targets):"),
-cl::values (clEnumValN (CodeGenFileType::AssemblyFile, "asm", "Emit an assembly ('.s') file"),
-clEnumValN (CodeGenFileType::ObjectFile, "obj", "Emit a native object ('.o') file"),
-clEnumValN (CodeGenFileType::Null, "null", "Emit nothing, for performance testing")));
+// Registers -filetype, -march, -mcpu, ... read through llvm::codegen::get*.
+static llvm::codegen::RegisterCodeGenFlags CGF;
 
 int main (int argc, const char** _argv) {
     llvm::InitLLVM X (argc, _argv);
@@ -323,16 +630,36 @@ int main (int argc, const char** _argv) {
 
     llvm::outs () << "INIT DONE\n";
 
+    if (ProfileGenerate.getNumOccurrences () && !ProfileUse.empty ()) {
+        llvm::WithColor::error (llvm::errs (), _argv[0])
+        << "-fprofile-generate and -fprofile-use can't be combined\n";
+        exit (EXIT_FAILURE);
+    }
+    if (!ProfileUse.empty () && !llvm::sys::fs::exists (ProfileUse)) {
+        llvm::WithColor::error (llvm::errs (), _argv[0])
+        << "profile '" << ProfileUse << "' does not exist\n";
+        exit (EXIT_FAILURE);
+    }
+
+    // Each input is compiled to an output of its own, which a single name
+    // can't hold; only --lto-link combines its inputs into one.
+    if (OutputName.getNumOccurrences () && InputFiles.size () > 1 && !LTOLink) {
+        llvm::WithColor::error (llvm::errs (), _argv[0])
+        << "-o can't be used with more than one input file\n";
+        exit (EXIT_FAILURE);
+    }
+
     default_cpu ();
 
+    if (LTOLink)
+        return ltoLink (_argv[0], OutputName) ? EXIT_SUCCESS : EXIT_FAILURE;
+
     llvm::TargetMachine* TM = createTarget ();
     if (!TM)
         exit (EXIT_FAILURE);
 
 
-    llvm::SmallVector<const char*, 256> argv (_argv + 1, _argv + argc);
-
-    for (const char* Filename : argv) {
+    for (const std::string& Filename : InputFiles) {
         auto File = llvm::MemoryBuffer::getFile (Filename);
         if (std::error_code BufferError = File.getError ()) {
             auto msg = BufferError.message ();
@@ -357,13 +684,13 @@ int main (int argc, const char** _argv) {
         if (Mod && !Diag.numErrors ()) {
             llvm::LLVMContext Ctx;
             if (amanlang::CodeGen* CG = amanlang::CodeGen::create (Ctx, TM, ASTCtx)) {
-                std::unique_ptr<llvm::Module> M = CG->run (Mod, InputFile);
-                if (!emit (_argv[0], M.get (), TM, InputFile)) {
+                std::unique_ptr<llvm::Module> M = CG->run (Mod, Filename);
+                if (!emit (_argv[0], M.get (), TM, Filename)) {
                     llvm::WithColor::error (llvm::errs (), +_argv[0]) << "Error writing output\n";
                 }
                 delete CG;
             }
         }
-        return 0;
     }
+    return 0;
 }
\ No newline at end of file